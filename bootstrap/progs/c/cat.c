@@ -0,0 +1,41 @@
+/*
+ * Copies files (or stdin) to stdout, in large blocks.
+ *
+ *   cat [file...]
+ *
+ * (used by `bench-stdio.ts` to measure output throughput)
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+static char buf[1 << 16];
+
+static int copy(int fd) {
+    ssize_t rd;
+    while ((rd = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t off = 0; off < rd; ) {
+            ssize_t wr = write(1, buf + off, rd - off);
+            if (wr < 0) { perror("write"); return 1; }
+            off += wr;
+        }
+    }
+    if (rd < 0) { perror("read"); return 1; }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int rc = 0;
+
+    if (argc < 2) return copy(0);
+
+    for (int i = 1; i < argc; i++) {
+        int fd = open(argv[i], O_RDONLY);
+        if (fd < 0) { perror(argv[i]); rc = 1; continue; }
+        rc |= copy(fd);
+        close(fd);
+    }
+    return rc;
+}
@@ -0,0 +1,71 @@
+/*
+ * Benchmark: time to load and link dynamic libraries.
+ *
+ *   dl-bench [-lazy] [-call <sym>] /usr/lib/dllunix.so /usr/lib/dllcamlstr.so ...
+ *
+ * `-lazy` opens with `RTLD_LAZY` instead of `RTLD_NOW`; symbols that are
+ * missing at load time are then looked up on their first call.
+ * `-call` also times the first and second call of a `void (void)` symbol
+ * in each library; either should cost the same in both modes, since
+ * symbols found at load time are bound directly.
+ * The address space taken up by the libraries (as reserved by the loader,
+ * from their `dylink.0` sizes) is printed before and after.
+ *
+ * (see `tut-ocaml.ts` for a volume that has the OCaml stub libraries)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void print_usage(const char *when) {
+    struct __wasik_dlusage u;
+    __wasik_dlusage(&u);
+    printf("%-40s %u KB memory, %u table slots, %u libraries   (memory %lu pages)\n",
+           when, u.memory >> 10, u.table, u.libraries, __builtin_wasm_memory_size(0));
+}
+
+int main(int argc, char *argv[]) {
+    int mode = RTLD_NOW;
+    const char *call = 0;
+    double total = 0;
+
+    print_usage("(before)");
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-lazy") == 0) { mode = RTLD_LAZY; continue; }
+        if (strcmp(argv[i], "-call") == 0 && i + 1 < argc) { call = argv[++i]; continue; }
+
+        double start = now();
+        void *h = dlopen(argv[i], mode);
+        double elapsed = now() - start;
+
+        if (!h) {
+            printf("%-40s failed: %s\n", argv[i], dlerror());
+            continue;
+        }
+        printf("%-40s %8.2fms", argv[i], elapsed * 1e3);
+        total += elapsed;
+
+        void (*f)(void) = call ? (void (*)(void))dlsym(h, call) : 0;
+        if (f) {
+            double t0 = now(); f();
+            double t1 = now(); f();
+            double t2 = now();
+            printf("   %s: first call %.3fms, second %.3fms", call, (t1 - t0) * 1e3, (t2 - t1) * 1e3);
+        }
+        printf("\n");
+    }
+    printf("%-40s %8.2fms  (%s)\n", "(total)", total * 1e3,
+           mode == RTLD_LAZY ? "RTLD_LAZY" : "RTLD_NOW");
+    print_usage("(after)");
+
+    return 0;
+}
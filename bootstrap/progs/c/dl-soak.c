@@ -0,0 +1,55 @@
+/*
+ * Soak test: repeatedly open, look up and close a dynamic library.
+ * Memory should stay flat once the first iteration has reserved the
+ * library's region, since `dlclose` hands it back for reuse.
+ *
+ *   dl-soak [-n <iterations>] /usr/lib/dllunix.so <symbol>
+ *
+ * (see `tut-ocaml.ts` for a volume that has the OCaml stub libraries)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+
+static unsigned long pages() {
+    return __builtin_wasm_memory_size(0);
+}
+
+int main(int argc, char *argv[]) {
+    int n = 1000, i = 1;
+
+    if (i + 1 < argc && strcmp(argv[i], "-n") == 0) { n = atoi(argv[i + 1]); i += 2; }
+    if (i + 2 > argc) {
+        fprintf(stderr, "usage: dl-soak [-n <iterations>] <library> <symbol>\n");
+        return 1;
+    }
+    const char *lib = argv[i], *sym = argv[i + 1];
+
+    /* opening twice gives the same handle */
+    void *h1 = dlopen(lib, RTLD_NOW), *h2 = dlopen(lib, RTLD_NOW);
+    if (!h1) { printf("%s: %s\n", lib, dlerror()); return 1; }
+    printf("same handle: %s\n", h1 == h2 ? "yes" : "NO");
+    dlclose(h2);
+    dlclose(h1);
+
+    unsigned long start = pages();
+    void *first = 0;
+
+    for (int k = 1; k <= n; k++) {
+        void *h = dlopen(lib, RTLD_NOW);
+        if (!h) { printf("[%d] %s: %s\n", k, lib, dlerror()); return 1; }
+        void *f = dlsym(h, sym);
+        if (!f) { printf("[%d] %s: %s\n", k, sym, dlerror()); return 1; }
+        if (!first) first = f;
+        if (dlclose(h) != 0) { printf("[%d] dlclose failed\n", k); return 1; }
+
+        if (k % 100 == 0 || k == n)
+            printf("%6d iterations   memory %lu pages (%+ld)   %s %s\n", k, pages(),
+                   (long)(pages() - start), sym, f == first ? "(same slot)" : "(new slot)");
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * Floods stdout with short lines, one `write` each, like a chatty build log.
+ *
+ *   flood [lines]
+ *
+ * (used by `bench-term.ts`)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+int main(int argc, char *argv[]) {
+    long lines = argc > 1 ? atol(argv[1]) : 100000;
+    char buf[96];
+
+    for (long i = 0; i < lines; i++) {
+        /* a multi-byte character, to end up split across chunks */
+        int n = snprintf(buf, sizeof(buf), "[%6ld] compiling module %ld … ok\n", i, i % 977);
+        if (write(1, buf, n) < 0) { perror("write"); return 1; }
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Benchmark: latency of `open()` on files in lazily populated volumes.
+ * The first open of each file runs the volume's filesystem hook (cold);
+ * the second one does not (warm).
+ *
+ *   hook-open /lazy/0/file /lazy/1/file ...
+ *
+ * (see `bench-fs-hook.ts` for the volumes)
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double timed_open(const char *fn) {
+    double start = now();
+    int fd = open(fn, O_RDONLY);
+    double elapsed = now() - start;
+    if (fd < 0) { perror(fn); return -1; }
+    close(fd);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    double cold = 0, warm = 0, worst = 0;
+    int n = 0;
+
+    for (int i = 1; i < argc; i++) {
+        double c = timed_open(argv[i]), w = timed_open(argv[i]);
+        if (c < 0 || w < 0) continue;
+        cold += c; warm += w; n++;
+        if (c > worst) worst = c;
+    }
+    if (n == 0) return 1;
+
+    printf("%d files: cold open %.3fms avg (%.3fms worst), warm open %.3fms avg\n",
+           n, cold / n * 1e3, worst * 1e3, warm / n * 1e3);
+    return 0;
+}
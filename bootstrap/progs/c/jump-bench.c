@@ -0,0 +1,85 @@
+/*
+ * Microbenchmark: setjmp/longjmp round trips per second.
+ *
+ * Build twice from `wasi-kit.json`:
+ *  - `jump-bench`    (`"sjlj": "wasm"`) -- native Wasm exception handling;
+ *  - `jump-bench-js` (`-fblocks`)       -- kernel's `__control_setjmp` (JS path).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <time.h>
+
+#if __has_extension(blocks)
+#include <wasi/control.h>
+#endif
+
+#define DEFAULT_ITERS 100000
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *path, int iters, double elapsed) {
+    printf("%-10s %8d jumps in %.3fs  (%.0f jumps/s)\n",
+           path, iters, elapsed, iters / elapsed);
+}
+
+static jmp_buf env;
+
+__attribute__((noinline)) static void jump_out(int v) {
+    longjmp(env, v);
+}
+
+#ifdef __wasm_exception_handling__
+
+static void bench_native(int iters) {
+    volatile int count = 0;
+    double start = now();
+
+    while (count < iters) {
+        if (setjmp(env) == 0)
+            jump_out(1);
+        count++;
+    }
+    report("wasm-eh", iters, now() - start);
+}
+
+#endif
+
+#if __has_extension(blocks)
+
+__attribute__((noinline)) static void control_jump_out(int v) {
+    __control_longjmp(env, v);
+}
+
+static void bench_control(int iters) {
+    __block int count = 0;
+    double start = now();
+
+    while (count < iters) {
+        __control_setjmp(env, ^(int r) {
+            if (r == 0) control_jump_out(1);
+            count++;
+        });
+    }
+    report("js-control", iters, now() - start);
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+    int iters = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERS;
+
+#ifdef __wasm_exception_handling__
+    bench_native(iters);
+#endif
+#if __has_extension(blocks)
+    bench_control(iters);
+#endif
+    (void)jump_out;
+    return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Microbenchmark: cost of polling for pending signals, as an interpreter
+ * would do in its interrupt check.
+ * Polls first with nothing pending, then with SIGUSR1 pending (it has no
+ * handler, so it stays pending throughout).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+
+#define DEFAULT_ITERS 1000000
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench(const char *label, int iters) {
+    int hits = 0;
+    double start = now();
+    for (int i = 0; i < iters; i++)
+        if (__wasi_sigpending()) hits++;
+    double elapsed = now() - start;
+    printf("%-12s %8d polls in %.3fs  (%.1f ns/poll, %d hits)\n",
+           label, iters, elapsed, elapsed * 1e9 / iters, hits);
+}
+
+int main(int argc, char *argv[]) {
+    int iters = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERS;
+
+    bench("idle", iters);
+    __wasi_sigraise(SIGUSR1);
+    bench("pending", iters);
+
+    return 0;
+}
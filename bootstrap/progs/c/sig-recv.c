@@ -0,0 +1,35 @@
+/*
+ * Receives signals queued by the host (`ChildProcess.signals`): prints
+ * `ready`, then the payload of each of `count` SIGRTMIN signals, in the
+ * order they arrive.
+ *
+ *   sig-recv [count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+/* (`sigemptyset` & co. are not in wasi-libc) */
+static void setmask(sigset_t *set, int signo) {
+    memset(set, 0, sizeof *set);
+    ((unsigned *)set)[(signo - 1) / 32] = 1u << ((signo - 1) % 32);
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 10;
+    sigset_t set;
+    siginfo_t info;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    setmask(&set, SIGRTMIN);
+    printf("ready\n");
+
+    for (int i = 0; i < count; i++) {
+        if (sigwaitinfo(&set, &info) < 0) { printf("sigwaitinfo: %s\n", strerror(errno)); return 1; }
+        printf("%d\n", info.si_value.sival_int);
+    }
+    printf("done\n");
+    return 0;
+}
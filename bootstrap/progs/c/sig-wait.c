@@ -0,0 +1,60 @@
+/*
+ * Blocking signal waits: `sigtimedwait` with a timeout, `sigwait` and
+ * `sigsuspend`. None of these should use any CPU while waiting;
+ * with no argument, the last wait is for a SIGCHLD sent from the host
+ * (`ChildProcess.signals`).
+ *
+ *   sig-wait [-self]     -- `-self` raises SIGCHLD itself instead
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* (`sigemptyset` & co. are not in wasi-libc) */
+static void setmask(sigset_t *set, unsigned bits) {
+    memset(set, 0, sizeof *set);
+    *(unsigned *)set = bits;
+}
+
+static void on_chld(int sig) {
+    printf("handler: signal %d\n", sig);
+}
+
+int main(int argc, char *argv[]) {
+    sigset_t set;
+    int sig;
+
+    setmask(&set, 1u << (SIGUSR1 - 1));
+
+    struct timespec timeout = {0, 100 * 1000 * 1000};
+    double start = now();
+    int rc = sigtimedwait(&set, 0, &timeout);
+    printf("sigtimedwait: %d (%s) after %.0fms\n", rc,
+           rc < 0 ? strerror(errno) : "signal", (now() - start) * 1e3);
+
+    __wasi_sigraise(SIGUSR1);
+    sigwait(&set, &sig);
+    printf("sigwait: signal %d\n", sig);
+
+    signal(SIGCHLD, on_chld);
+    if (argc > 1 && strcmp(argv[1], "-self") == 0)
+        __wasi_sigraise(SIGCHLD);
+    else
+        printf("waiting for SIGCHLD...\n");
+    fflush(stdout);
+
+    setmask(&set, 0);
+    start = now();
+    sigsuspend(&set);
+    printf("sigsuspend: returned after %.0fms\n", (now() - start) * 1e3);
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Benchmark: process spawn latency, `posix_spawn` to `waitpid`.
+ * Spawns itself (with `-child`, which exits right away) a number of times,
+ * and reports the first (cold) spawn separately from the rest (warm).
+ *
+ *   spawn-bench [<count>]
+ *
+ * Compare runs with the worker pool on and off (`System.startup({}, {pool: false})`).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#define DEFAULT_COUNT 50
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int cmp(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(double *sorted, int n, double p) {
+    return sorted[(int)(p * (n - 1) + 0.5)];
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "-child") == 0) return 0;
+
+    int count = argc > 1 ? atoi(argv[1]) : DEFAULT_COUNT;
+    if (count < 2) count = 2;
+    double *lat = malloc(count * sizeof(double));
+    char *const child_argv[] = {argv[0], "-child", 0};
+    char *const child_env[] = {0};
+
+    for (int i = 0; i < count; i++) {
+        pid_t pid;
+        int status;
+        double start = now();
+        int rc = posix_spawn(&pid, argv[0], 0, 0, child_argv, child_env);
+        if (rc != 0) { printf("posix_spawn: %s\n", strerror(rc)); return 1; }
+        waitpid(pid, &status, 0);
+        lat[i] = (now() - start) * 1e3;
+    }
+
+    printf("cold  (first spawn)  %8.2fms\n", lat[0]);
+    qsort(lat + 1, count - 1, sizeof(double), cmp);
+    printf("warm  (%d spawns)    p50 %8.2fms   p99 %8.2fms   max %8.2fms\n", count - 1,
+           percentile(lat + 1, count - 1, 0.5), percentile(lat + 1, count - 1, 0.99),
+           lat[count - 1]);
+
+    free(lat);
+    return 0;
+}
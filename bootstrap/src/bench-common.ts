@@ -0,0 +1,37 @@
+/**
+ * Shared by the benchmarks (`bench-*.ts`) and checks (`test-*.ts`) in this
+ * directory. Each of them default-exports a `main`; `index.ts` runs one
+ * when the page is opened with `?run=<name>`, e.g. `index.html?run=bench-spawn`.
+ * Most read their programs (`*.wasm`, from `progs/c`) from the current directory.
+ */
+
+const uris = {
+    wasmBindgen: '/node_modules/@wasmer/sdk/dist/wasmer_js_bg.wasm',
+    sdk: '/node_modules/@wasmer/sdk/dist/index.mjs',
+    worker: '/src/worker.js'
+};
+
+/** (Chromium only; 0 elsewhere) */
+function heapUsed(): number {
+    return (performance as any).memory?.usedJSHeapSize ?? 0;
+}
+
+/** Samples `heapUsed` every `ms` milliseconds, until stopped. */
+class HeapPeak {
+    base = heapUsed()
+    peak = this.base
+    _timer: ReturnType<typeof setInterval>
+
+    constructor(ms = 10) {
+        this._timer = setInterval(() => this.peak = Math.max(this.peak, heapUsed()), ms);
+    }
+
+    /** @returns the peak above the heap at start, in MB */
+    stop() {
+        clearInterval(this._timer);
+        return (Math.max(this.peak, heapUsed()) - this.base) / (1 << 20);
+    }
+}
+
+
+export { uris, HeapPeak }
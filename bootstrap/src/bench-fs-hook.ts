@@ -0,0 +1,56 @@
+/**
+ * Benchmark: latency of a cold `open()` that triggers a filesystem hook.
+ * Mounts `COUNT` lazily populated volumes, each with one file that its hook
+ * writes on first access, and has `hook-open.c` open each file twice.
+ * Then, `PARALLEL` processes at once open a file in one fresh volume whose
+ * hook is slow (like a download); it should run exactly once.
+ */
+import fs from 'fs';
+
+import { System } from '../../src/sys.ts';
+import { DirectoryVolumeAdapter } from '../../src/services/package-mgr.ts';
+import { FsHookMaster } from '../../src/services/fs.ts';
+import { uris } from './bench-common.ts';
+
+const COUNT = 200,
+      PARALLEL = 8,
+      DOWNLOAD_MS = 500;
+
+async function main() {
+    let sys = new System(uris);
+    await sys.startup();
+
+    let payload = new Uint8Array(4096).fill(0x61), populated = 0;
+    for (let i = 0; i < COUNT; i++) {
+        let vol = new DirectoryVolumeAdapter().withHook(async vol => {
+            await vol.writeFile('/file', payload);
+            populated++;
+        });
+        await sys.vfs.mount(`/lazy/${i}`, vol);
+    }
+
+    let bin = new Uint8Array(fs.readFileSync('hook-open.wasm')),
+        p = await sys.runWasix(bin, {program: 'hook-open',
+                                     args: Array.from({length: COUNT}, (_, i) => `/lazy/${i}/file`)});
+    for await (let s of p.read()) console.log(s.trimEnd());
+    console.log(`(${populated} hooks ran)`);
+
+    let downloads = 0,
+        toolchain = new DirectoryVolumeAdapter().withHook(async vol => {
+            downloads++;
+            await new Promise(resolve => setTimeout(resolve, DOWNLOAD_MS));
+            await vol.writeFile('/file', payload);
+        });
+    await sys.vfs.mount('/toolchain', toolchain);
+
+    let start = performance.now(),
+        ps = await Promise.all(Array.from({length: PARALLEL}, () =>
+            sys.runWasix(bin, {program: 'hook-open', args: ['/toolchain/file']})));
+    await Promise.all(ps.map(async p => { for await (let _ of p.read()); }));
+
+    let stats = (globalThis.fs_hook as FsHookMaster).stats;
+    console.log(`${PARALLEL} processes on a fresh mount: ${downloads} download(s), ` +
+                `done in ${(performance.now() - start).toFixed(0)}ms; hook stats:`, stats);
+}
+
+export default main;
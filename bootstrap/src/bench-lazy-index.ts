@@ -0,0 +1,50 @@
+/**
+ * Check: how much of a lazily mounted, indexed bundle gets fetched when a
+ * program touches 5 of its 5000 files. The bundle is 100 directories of
+ * 50 files, 1KB each, concatenated in one blob; `hook-open.c` opens one file
+ * in each of 5 directories, so just those 5 files (5KB of 5MB) should be
+ * fetched.
+ */
+import fs from 'fs';
+
+import { System } from '../../src/sys.ts';
+import { PackageManager, Lazily, ResourceBlob, BundleIndex } from '../../src/services/package-mgr.ts';
+import { uris } from './bench-common.ts';
+
+const DIRS = 100,
+      FILES_PER_DIR = 50,
+      FILE_SIZE = 1024,
+      TOUCHED = ['/sdk/include/d0/f0.h', '/sdk/include/d7/f3.h', '/sdk/include/d42/f49.h',
+                 '/sdk/include/d77/f1.h', '/sdk/include/d99/f10.h'];
+
+function bundle() {
+    let files: BundleIndex['files'] = {}, parts: Uint8Array[] = [], offset = 0;
+    for (let d = 0; d < DIRS; d++)
+        for (let f = 0; f < FILES_PER_DIR; f++) {
+            parts.push(new Uint8Array(FILE_SIZE).fill(0x61 + f % 26));
+            files[`include/d${d}/f${f}.h`] = {size: FILE_SIZE, offset};
+            offset += FILE_SIZE;
+        }
+    return {base: new ResourceBlob(new Blob(parts), 'sdk.bin'), files, total: offset};
+}
+
+async function main() {
+    let sys = new System(uris);
+    await sys.startup();
+
+    let {base, files, total} = bundle(),
+        pm = new PackageManager(sys.vfs);
+    await pm.install({'/sdk/': Lazily.indexed({base, files})}, false);
+
+    let bin = new Uint8Array(fs.readFileSync('hook-open.wasm')),
+        p = await sys.runWasix(bin, {program: 'hook-open', args: TOUCHED});
+    for await (let s of p.read()) console.log(s.trimEnd());
+
+    let expected = TOUCHED.length * FILE_SIZE;
+    console.log(`touched ${TOUCHED.length} of ${DIRS * FILES_PER_DIR} files: ` +
+                `fetched ${pm.stats.filesFetched} files, ${pm.stats.bytesFetched} of ${total} bytes`);
+    console.assert(pm.stats.bytesFetched <= expected,
+                   `expected at most ${expected} bytes fetched, got ${pm.stats.bytesFetched}`);
+}
+
+export default main;
@@ -0,0 +1,46 @@
+/**
+ * Benchmark: spawn 100 processes at once through `System.runWasix`, and
+ * report throughput, with spawns in the init process handled one at a time,
+ * concurrently, and sharded over several init processes.
+ */
+import fs from 'fs';
+
+import { System } from '../../src/sys.ts';
+import type { InitOptions } from '../../src/services/init-process.ts';
+import { uris } from './bench-common.ts';
+
+const COUNT = 100;
+
+const CONFIGS: [string, InitOptions & {shards?: number}][] = [
+    ['sequential', {concurrency: 1}],
+    ['concurrent', {concurrency: 8}],
+    ['sharded x4', {concurrency: 8, shards: 4}]
+];
+
+async function bench(label: string, opts: InitOptions & {shards?: number}, bin: Uint8Array) {
+    let sys = new System(uris);
+    await sys.startup({}, opts);
+    await drain(await sys.runWasix(bin, {program: 'hello'}));   /* compile, warm up */
+
+    let start = performance.now(),
+        ps = await Promise.all(Array.from({length: COUNT},
+            () => sys.runWasix(bin, {program: 'hello'}))),
+        spawned = performance.now() - start;
+    await Promise.all(ps.map(drain));
+    let done = performance.now() - start;
+
+    console.log(`${label.padEnd(12)} ${COUNT} spawns in ${spawned.toFixed(0)}ms, ` +
+                `all exited in ${done.toFixed(0)}ms  (${(COUNT / done * 1e3).toFixed(1)} processes/s)`);
+}
+
+async function drain(p: {readRaw(): AsyncIterable<unknown>}) {
+    for await (let _ of p.readRaw());
+}
+
+async function main() {
+    let bin = new Uint8Array(fs.readFileSync('hello.wasm'));
+    for (let [label, opts] of CONFIGS)
+        await bench(label, opts, bin);
+}
+
+export default main;
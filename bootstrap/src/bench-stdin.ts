@@ -0,0 +1,51 @@
+/**
+ * Benchmark: pipe a large input through `stdin.c`, feeding stdin with
+ * `ChildProcess.feed` from a Blob and from an async generator.
+ * Reports throughput and peak heap (which should stay well below the input
+ * size).
+ */
+import fs from 'fs';
+
+import { System } from '../../src/sys.ts';
+import type { ChildProcess, StdinSource } from '../../src/services/task-mgr.ts';
+import { uris, HeapPeak } from './bench-common.ts';
+
+const SIZE = 16 << 20;   /* `stdin.c` prints a line per 20 bytes read */
+
+async function *generate(size: number) {
+    let block = new Uint8Array(64 << 10).fill(0x61);
+    for (let at = 0; at < size; at += block.length)
+        yield block.subarray(0, Math.min(block.length, size - at));
+}
+
+async function bench(sys: System, bin: Uint8Array, label: string, src: () => StdinSource) {
+    let heap = new HeapPeak,
+        start = performance.now(),
+        p = await sys.runWasix(bin, {program: 'stdin'}),
+        [fed, lines] = await Promise.all([p.feed(src()), countLines(p)]),
+        secs = (performance.now() - start) / 1e3;
+    let peak = heap.stop();
+
+    console.log(`${label.padEnd(10)} ${(fed / (1 << 20) / secs).toFixed(1)} MB/s  ` +
+                `(${lines} lines out), peak heap +${peak.toFixed(1)} MB`);
+}
+
+async function countLines(p: ChildProcess) {
+    let n = 0;
+    for await (let {out} of p.readBatches())
+        if (out) for (let b of out) if (b === 0x0a) n++;
+    return n;
+}
+
+async function main() {
+    let sys = new System(uris);
+    await sys.startup();
+
+    let blob = new Blob([new Uint8Array(SIZE).fill(0x61)]);
+
+    let bin = new Uint8Array(fs.readFileSync('stdin.wasm'));
+    await bench(sys, bin, 'Blob', () => blob);
+    await bench(sys, bin, 'generator', () => generate(SIZE));
+}
+
+export default main;
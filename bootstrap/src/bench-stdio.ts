@@ -0,0 +1,50 @@
+/**
+ * Benchmark: throughput of process output, `cat` of a large file, with output
+ * coming through transferred streams vs. through shared memory (`stdio: 'ring'`).
+ */
+import fs from 'fs';
+
+import { System } from '../../src/sys.ts';
+import type { ChildProcess } from '../../src/services/task-mgr.ts';
+import { uris } from './bench-common.ts';
+
+const SIZE = 64 << 20,
+      ROUNDS = 3;
+
+async function bench(sys: System, bin: Uint8Array, stdio: 'stream' | 'ring') {
+    let best = 0, chunks = 0;
+    for (let i = 0; i < ROUNDS; i++) {
+        let start = performance.now(),
+            p = await sys.runWasix(bin, {program: 'cat', args: ['/home/big'], stdio}),
+            {bytes, n} = await count(p),
+            mbs = bytes / (1 << 20) / ((performance.now() - start) / 1e3);
+        if (bytes !== SIZE) console.warn(`[${stdio}] got ${bytes} bytes, expected ${SIZE}`);
+        if (mbs > best) { best = mbs; chunks = n; }
+    }
+    console.log(`${stdio.padEnd(8)} ${best.toFixed(1)} MB/s  (${chunks} reads)`);
+}
+
+async function count(p: ChildProcess) {
+    let bytes = 0, n = 0;
+    for await (let {out, err} of p.readBatches()) {
+        bytes += out?.length ?? 0;
+        if (err) console.error(new TextDecoder().decode(err));
+        n++;
+    }
+    return {bytes, n};
+}
+
+async function main() {
+    let sys = new System(uris);
+    await sys.startup();
+
+    let big = new Uint8Array(SIZE);
+    for (let i = 0; i < SIZE; i++) big[i] = 32 + i % 95;
+    await sys.vfs.writeFile('/home/big', big);
+
+    let bin = new Uint8Array(fs.readFileSync('cat.wasm'));
+    for (let stdio of ['stream', 'ring'] as const)
+        await bench(sys, bin, stdio);
+}
+
+export default main;
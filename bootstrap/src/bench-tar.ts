@@ -0,0 +1,51 @@
+/**
+ * Benchmark: installing a compressed sysroot tarball into a fresh volume,
+ * streaming (download, decompression and writes overlapping) vs. buffered
+ * (decompress the whole download, then extract).
+ * Reports end-to-end time and peak heap for each of `SYSROOTS` that exist.
+ *
+ * `.tar.zst` needs a zstd decoder in `PackageManager.decoders`, unless the
+ * engine's `DecompressionStream` does zstd; without one it is skipped.
+ */
+import fs from 'fs';
+import { init } from "@wasmer/sdk";
+
+import { PackageManager, ResourceBlob, DirectoryVolumeAdapter } from '../../src/services/package-mgr.ts';
+import { uris, HeapPeak } from './bench-common.ts';
+
+const SYSROOTS = ['sysroot.tar.gz', 'sysroot.tar.zst'];
+
+async function bench(label: string, install: (pm: PackageManager) => Promise<void>) {
+    let pm = new PackageManager(new DirectoryVolumeAdapter()), heap = new HeapPeak(5),
+        start = performance.now();
+    try {
+        await install(pm);
+        let ms = performance.now() - start;
+        console.log(`${label.padEnd(28)} ${ms.toFixed(0)}ms, peak heap +${heap.stop().toFixed(1)} MB`);
+    }
+    catch (e) { console.log(`${label.padEnd(28)} skipped: ${e.message}`); }
+    finally { heap.stop(); }
+}
+
+async function main() {
+    await init({module: uris.wasmBindgen});
+
+    for (let fn of SYSROOTS) {
+        let bytes: Uint8Array;
+        try { bytes = new Uint8Array(fs.readFileSync(fn)); }
+        catch { console.log(`${fn}: not found`); continue; }
+        let tarball = new ResourceBlob(new Blob([bytes]), fn),
+            format = fn.endsWith('.gz') ? 'gzip' : 'zstd';
+        console.log(`${fn}: ${(bytes.length / (1 << 20)).toFixed(1)} MB`);
+
+        await bench(`  buffered`, async pm => {
+            let tar = await new Response((await tarball.stream())
+                .pipeThrough(PackageManager.decoder(format))).blob();
+            pm.opts.streaming = false;
+            await pm.installTar('/', tar);
+        });
+        await bench(`  streaming`, pm => pm.installTar('/', tarball));
+    }
+}
+
+export default main;
@@ -0,0 +1,60 @@
+/**
+ * Benchmark: a guest flooding stdout into a (simulated) terminal, through
+ * `ChildProcess.pipeInto`. The terminal repaints on every write, which takes
+ * a while, so tiny writes mean many frames and little throughput.
+ * Reports frames/s, throughput and peak heap, without and with coalescing
+ * and flow control.
+ */
+import fs from 'fs';
+
+import { System } from '../../src/sys.ts';
+import type { PipeOptions } from '../../src/services/task-mgr.ts';
+import { uris, HeapPeak } from './bench-common.ts';
+
+const LINES = 200000,
+      FRAME_MS = 2;      /* cost of one repaint */
+
+const CONFIGS: [string, Partial<PipeOptions>][] = [
+    ['per chunk', {coalesceBytes: 0, highWater: Infinity}],
+    ['coalesced', {}]
+];
+
+/** Renders whatever was written since the last frame; one frame at a time. */
+class SlowTerminal {
+    text = ''
+    frames = 0
+    busy = Promise.resolve()
+
+    write(s: string) {
+        return this.busy = this.busy.then(() => new Promise<void>(resolve =>
+            setTimeout(() => {
+                this.text = (this.text + s).slice(-4096);   /* the visible part */
+                this.frames++;
+                resolve();
+            }, FRAME_MS)));
+    }
+}
+
+async function bench(sys: System, bin: Uint8Array, label: string, opts: Partial<PipeOptions>) {
+    let term = new SlowTerminal, heap = new HeapPeak,
+        start = performance.now(),
+        p = await sys.runWasix(bin, {program: 'flood', args: [`${LINES}`]}),
+        stats = await p.pipeInto(term, {encoding: 'utf-8', ...opts}),
+        secs = (performance.now() - start) / 1e3;
+    let peak = heap.stop();
+
+    console.log(`${label.padEnd(10)} ${(term.frames / secs).toFixed(0)} frames/s, ` +
+                `${(stats.bytes / (1 << 20) / secs).toFixed(2)} MB/s, ${stats.pauses} pauses, ` +
+                `peak heap +${peak.toFixed(1)} MB`);
+}
+
+async function main() {
+    let sys = new System(uris);
+    await sys.startup();
+
+    let bin = new Uint8Array(fs.readFileSync('flood.wasm'));
+    for (let [label, opts] of CONFIGS)
+        await bench(sys, bin, label, opts);
+}
+
+export default main;
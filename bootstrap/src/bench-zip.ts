@@ -0,0 +1,59 @@
+/**
+ * Benchmark: installing a large ZIP, all at once (`unzipSync`) vs. streaming.
+ * Reports time to first file written, total time, and peak heap.
+ * Files go to an in-memory volume that holds on to nothing, so that the heap
+ * is that of the extraction itself.
+ */
+import { zipSync } from 'fflate';
+
+import { PackageManager, ResourceBlob } from '../../src/services/package-mgr.ts';
+import { HeapPeak } from './bench-common.ts';
+
+const FILES = 1000,
+      FILE_SIZE = 64 << 10;   /* 64MB in all */
+
+/** Counts what is written, without keeping it. */
+class NullVolume {
+    firstWrite = 0
+    files = 0
+    async mkdir() { }
+    async writeFile(_: string, content: string | Uint8Array) {
+        if (this.files++ === 0) this.firstWrite = performance.now();
+    }
+    async readFile(): Promise<any> { throw new Error('write-only'); }
+    async readdir() { return []; }
+    async symlink() { }
+}
+
+function archive() {
+    let entries: {[fn: string]: Uint8Array} = {}, seed = 1;
+    for (let i = 0; i < FILES; i++) {
+        let data = new Uint8Array(FILE_SIZE);
+        for (let j = 0; j < FILE_SIZE; j++)   /* compresses, but not to nothing */
+            data[j] = (seed = (seed * 1103515245 + 12345) >>> 0) % 16 + 0x61;
+        entries[`lib/d${i % 20}/f${i}.bin`] = data;
+    }
+    return new Blob([zipSync(entries, {level: 1})]);
+}
+
+async function bench(label: string, zip: Blob, streaming: boolean) {
+    let vol = new NullVolume, pm = new PackageManager(vol), heap = new HeapPeak(5),
+        start = performance.now();
+    pm.opts.streaming = streaming;
+    await pm.installZip('/opt', new ResourceBlob(zip, 'bench.zip'));
+    let done = performance.now() - start;
+    let peak = heap.stop();
+
+    console.log(`${label.padEnd(10)} ${vol.files} files; first after ${(vol.firstWrite - start).toFixed(0)}ms, ` +
+                `all in ${done.toFixed(0)}ms; peak heap +${peak.toFixed(1)} MB`);
+}
+
+async function main() {
+    let zip = archive();
+    console.log(`archive: ${(zip.size / (1 << 20)).toFixed(1)} MB, ${FILES} files, ` +
+                `${(FILES * FILE_SIZE / (1 << 20)).toFixed(0)} MB inflated`);
+    await bench('unzipSync', zip, false);
+    await bench('streaming', zip, true);
+}
+
+export default main;
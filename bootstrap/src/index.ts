@@ -2,7 +2,23 @@
 import main from './tut-hello.ts';
 import './shell.css';
 
+/** Benchmarks and checks, run instead of `main` with `?run=<name>` */
+const runnable: {[name: string]: () => Promise<{default: () => Promise<void>}>} = {
+    'bench-spawn': () => import('./bench-spawn.ts'),
+    'bench-stdio': () => import('./bench-stdio.ts'),
+    'bench-term': () => import('./bench-term.ts'),
+    'bench-stdin': () => import('./bench-stdin.ts'),
+    'bench-fs-hook': () => import('./bench-fs-hook.ts'),
+    'bench-lazy-index': () => import('./bench-lazy-index.ts'),
+    'bench-zip': () => import('./bench-zip.ts'),
+    'bench-tar': () => import('./bench-tar.ts'),
+    'test-signals': () => import('./test-signals.ts')
+};
+
 
 if (typeof window !== 'undefined') {
-    main();
-}
\ No newline at end of file
+    let run = new URLSearchParams(location.search).get('run');
+    if (!run) main();
+    else if (runnable[run]) runnable[run]().then(m => m.default());
+    else console.error(`unknown '${run}'; one of: ${Object.keys(runnable).join(', ')}`);
+}
@@ -7,7 +7,7 @@ class MiniTerm {
     constructor(el: HTMLDivElement) { this.el = el; }
 
     write(s: string | Uint8Array) {
-        if (s instanceof Uint8Array) s = this.td.decode(s);
+        if (s instanceof Uint8Array) s = this.td.decode(s, {stream: true});
         this.text += s;
         if (this.el) this.el.textContent = this.text;
     }
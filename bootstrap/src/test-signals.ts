@@ -0,0 +1,81 @@
+/**
+ * Test: signals sent and queued from the host, through `ChildProcess.signals`.
+ *  - `sig-wait.c` gets the SIGCHLD that its `sigsuspend` waits for; the
+ *    host sees it as a `'signal'` event, and the vector goes dead at exit;
+ *  - `sig-recv.c` gets `COUNT` queued SIGRTMIN signals, payloads in order.
+ * Failures are reported with `console.assert`.
+ */
+import fs from 'fs';
+
+import { System } from '../../src/sys.ts';
+import type { ChildProcess } from '../../src/services/task-mgr.ts';
+import { SIGRTMIN } from '../../src/core/bits/signals.ts';
+import { uris } from './bench-common.ts';
+
+const SIGCHLD = 17,
+      COUNT = 1000;
+
+/** Collects a process' output; `until` waits for a line to show up. */
+function collect(p: ChildProcess) {
+    let text = '', waiters: (() => void)[] = [],
+        done = (async () => {
+            for await (let s of p.read()) {
+                text += s;
+                waiters.splice(0).forEach(w => w());
+            }
+        })();
+    return {
+        get text() { return text; },
+        done,
+        async until(line: string) {
+            while (!text.split('\n').includes(line))
+                await new Promise<void>(resolve => waiters.push(resolve));
+        }
+    };
+}
+
+async function testSend(sys: System) {
+    let p = await sys.runWasix(new Uint8Array(fs.readFileSync('sig-wait.wasm')),
+                               {program: 'sig-wait', stdio: 'ring'}),
+        out = collect(p), observed: number[] = [];
+    console.assert(p.signals, 'no signal vector for the process');
+    p.on('signal', (signum: number) => observed.push(signum));
+    await out.until('waiting for SIGCHLD...');
+    p.signals.send(SIGCHLD);
+    await out.done;
+    for (let i = 0; i < 100 && p.signals.live; i++)
+        await new Promise(resolve => setTimeout(resolve, 10));
+    console.assert(observed.includes(SIGCHLD), 'no \'signal\' event for SIGCHLD:', observed);
+    console.assert(!p.signals.live && !p.signals.send(SIGCHLD), 'signal vector still live after exit');
+    p.removeAllListeners('signal');
+    console.assert(out.text.includes(`handler: signal ${SIGCHLD}`), 'SIGCHLD not handled:', out.text);
+    console.assert(/sigsuspend: returned/.test(out.text), 'sigsuspend did not return:', out.text);
+}
+
+async function testQueue(sys: System) {
+    let p = await sys.runWasix(new Uint8Array(fs.readFileSync('sig-recv.wasm')),
+                               {program: 'sig-recv', args: [`${COUNT}`], stdio: 'ring'}),
+        out = collect(p);
+    await out.until('ready');
+    let start = performance.now(), sent = 0;
+    while (sent < COUNT) {
+        if (p.signals.queue(SIGRTMIN, sent)) sent++;
+        else await new Promise(resolve => setTimeout(resolve, 1));  /* queue full */
+    }
+    await out.done;
+    let values = out.text.split('\n').filter(l => /^\d+$/.test(l)).map(Number);
+    console.assert(values.length === COUNT, `received ${values.length} of ${COUNT}`);
+    console.assert(values.every((v, i) => v === i), 'payloads out of order');
+    console.log(`queued ${COUNT} signals from the host in ${(performance.now() - start).toFixed(1)}ms`);
+}
+
+async function main() {
+    let sys = new System(uris);
+    await sys.startup();
+
+    await testSend(sys);
+    await testQueue(sys);
+    console.log('signals: done');
+}
+
+export default main;
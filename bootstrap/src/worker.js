@@ -5,17 +5,28 @@ globalThis.onerror = console.error;
 globalThis.lastWasmError = undefined;
 
 let pendingMessages = [];
+let sdk, kernel;  // imports started early by a `prewarm` message (see `WorkerPool`)
+let prewarmed;    // `init` too, if the message came with the memory
 let worker = {
   // Buffering up all messages until worker is initialized.
   handleMessage(msg) { pendingMessages.push(msg); }
 };
 
 globalThis.onmessage = async ev => {
+  if (ev.data.type == "prewarm") {
+    const { sdkUrl, module, memory } = ev.data;
+    sdk ??= import(sdkUrl);
+    kernel ??= import('../build/worker/worker.js');
+    if (memory) prewarmed ??= sdk.then(m => m.init({ module, memory }));
+    return;
+  }
   if (ev.data.type == "init") {
-    const { module, id, sdkUrl, workerUrl, memory } = ev.data;
-    await import('../build/worker/worker.js');
-    worker = new WasikThreadPoolWorker(await import(sdkUrl));
-    await worker.init(id, { module, sdkUrl, workerUrl, memory });
+    const { module, id, sdkUrl, workerUrl, memory, pool, concurrency, signals, modules } = ev.data;
+    await (kernel ??= import('../build/worker/worker.js'));
+    worker = new WasikThreadPoolWorker(await (sdk ?? import(sdkUrl)));
+    await prewarmed;
+    await worker.init(id, { module, sdkUrl, workerUrl, memory },
+                      { pool, concurrency, signals, modules, prewarmed: !!prewarmed });
     // handle any buffered messages
     worker.consume(pendingMessages);
   }
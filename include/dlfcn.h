@@ -15,14 +15,21 @@ void*
 int
      dlclose(void* handle) __WASIK_EXTERNAL_NAME(dlclose);
 
+extern char *__wasi_dlerror(void) __WASIK_EXTERNAL_NAME(dlerror);
 extern int __wasi_dlerror_get(char **buf) __WASIK_EXTERNAL_NAME(dlerror_get);
 
 static inline const char* dlerror(void) {
-     char *buf = 0;
-     __wasi_sorry(buf = (char*)malloc(__wasi_dlerror_get(&buf)));
+     static __WASIK_THREAD_LOCAL char *buf = 0;  /* (per thread, as is the kernel's error) */
+     free(buf);  /* previous message */
+     if (!(buf = __wasi_dlerror()))
+          __wasi_sorry(buf = (char*)malloc(__wasi_dlerror_get(&buf)));
      return buf;
 }
 
+/* wasi-kernel extension: address space taken up by open libraries */
+struct __wasik_dlusage { unsigned memory, table, libraries; };
+extern int __wasik_dlusage(struct __wasik_dlusage *out) __WASIK_EXTERNAL_NAME(dlusage);
+
 static void *const RTLD_DEFAULT = 0;
 static const int RTLD_NOW = 1;
 static const int RTLD_LAZY = 2;
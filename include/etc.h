@@ -22,9 +22,11 @@
 #define restrict
 #define WASI_C_START extern "C" {
 #define WASI_C_END }
+#define __WASIK_THREAD_LOCAL thread_local
 #else
 #define WASI_C_START
 #define WASI_C_END
+#define __WASIK_THREAD_LOCAL _Thread_local
 #endif
 
 
@@ -56,14 +58,21 @@ extern void __wasi_trace(const char *) __WASIK_EXTERNAL_NAME(trace);
 extern void __wasi_sorry(void *) __WASIK_EXTERNAL_NAME(sorry);
 
 void *malloc(size_t);
+void free(void *);
+
+/* Strings returned by the kernel are allocated with the program's own
+ * `malloc` (exported by wasi-kit). If it is not exported, these return 0
+ * and the older `*_get` + `__wasi_sorry` protocol is used instead. */
 
 /* stdlib.h */
 
+extern char *__wasi_progname(void) __WASIK_EXTERNAL_NAME(progname);
 extern int __wasi_progname_get(char **pbuf) __WASIK_EXTERNAL_NAME(progname_get);
 
 static inline const char *getprogname(void) {
      static char *buf = 0;
-     if (!buf) __wasi_sorry(buf = (char*)malloc(__wasi_progname_get(&buf)));
+     if (!buf && !(buf = __wasi_progname()))
+          __wasi_sorry(buf = (char*)malloc(__wasi_progname_get(&buf)));
      return buf;
 }
 
@@ -243,11 +252,13 @@ char *
 int
      ttyname_r(int fd, char *buf, size_t len);
 
+extern char *__wasi_login(void) __WASIK_EXTERNAL_NAME(login);
 extern int __wasi_login_get(char **pbuf) __WASIK_EXTERNAL_NAME(login_get);
 
 static inline char *getlogin(void) {
      static char *buf = 0;
-     if (!buf) __wasi_sorry(buf = (char*)malloc(__wasi_login_get(&buf)));
+     if (!buf && !(buf = __wasi_login()))
+          __wasi_sorry(buf = (char*)malloc(__wasi_login_get(&buf)));
      return buf;
 }
 
@@ -1,6 +1,9 @@
 #pragma once
 
-#ifdef __wasix__
+/* wasix-libc, and wasi-libc when compiled with `-mllvm -wasm-enable-sjlj`
+ * (wasi-kit `"sjlj": "wasm"`), provide a native setjmp/longjmp */
+#if defined(__wasix__) || defined(__wasm_exception_handling__)
+#define _WASIK_LIBC_SETJMP
 #include_next <setjmp.h>
 #endif
 
@@ -13,7 +16,7 @@ struct __wasik_jmp_buf {
     setjmp_ret_val ret_val; 
 };
 
-#ifndef __wasix__
+#ifndef _WASIK_LIBC_SETJMP
 #define __jmp_buf __wasik_jmp_buf
 
 typedef struct __jmp_buf jmp_buf[1];
@@ -8,10 +8,48 @@
 
 WASI_C_START
 
+/* kernel's own signal vector (see `SignalVector`); bit `signo - 1` */
+extern unsigned __wasi_sigpending(void) __WASIK_EXTERNAL_NAME(sigpending);
+extern unsigned __wasi_sigpending_hi(void) __WASIK_EXTERNAL_NAME(sigpending_hi);   /* signals 33-64 */
+extern int __wasi_sigraise(int signo) __WASIK_EXTERNAL_NAME(sigraise);
+extern void __wasi_sigattach(int slot) __WASIK_EXTERNAL_NAME(sigattach);
+
+#include <stdlib.h>
+
+/*
+ * Joins the process' signal vector, whose slot the kernel puts in the
+ * environment; until then, signals from the host or from other threads are
+ * not seen. Once per thread: at startup for the main thread, and from the
+ * wrappers below for the others.
+ */
+static inline void __wasik_sigattach(void) {
+    static __WASIK_THREAD_LOCAL int attached = 0;
+    if (!attached) {
+        const char *slot = getenv("WASIK_SIGVEC");
+        if (slot) __wasi_sigattach(atoi(slot));
+        attached = 1;
+    }
+}
+
+__attribute__((constructor)) static void __wasik_sigattach_main(void) {
+    __wasik_sigattach();
+}
+
 /* skip if wasix-libc is used, which already defines these */
 #ifndef SIG_BLOCK
 
-typedef int siginfo_t;
+#ifndef SIGEV_SIGNAL
+union sigval {
+    int     sival_int;
+    void   *sival_ptr;
+};
+#endif
+
+typedef struct {
+    int     si_signo;
+    int     si_code;
+    union sigval si_value;          /* as passed to `sigqueue` */
+} siginfo_t;
 
 union __sigaction_u {
     void    (*__sa_handler)(int);
@@ -30,10 +68,6 @@ struct  sigaction {
 
 int
     sigaction(int sig, const struct sigaction *restrict act, struct sigaction *restrict oact);
-int
-    sigwait(const sigset_t *restrict set, int *restrict sig);
-int
-    sigpending(sigset_t *set);
 
 int
     sigaddset(sigset_t *set, int signo);
@@ -68,6 +102,80 @@ enum __sa_flags {
 // Signal numbers
 #include <bits/alltypes.h>
 
+#ifndef SIGRTMIN
+#define SIGRTMIN 34
+#define SIGRTMAX 64
+#endif
+
+/*
+ * Waiting for signals, on top of the kernel's signal vector.
+ * Only signals 1-64 of a `sigset_t` are looked at.
+ * Defined as macros so as not to clash with libc's prototypes.
+ */
+
+#include <errno.h>
+#include <time.h>
+
+extern int __wasi_sigtimedwait(unsigned mask, unsigned mask_hi, double timeout_ms,
+                               int *value) __WASIK_EXTERNAL_NAME(sigtimedwait);
+extern int __wasi_sigqueue(int signo, int value) __WASIK_EXTERNAL_NAME(sigqueue);
+
+#define __wasik_sigword(set, i) \
+    (sizeof(sigset_t) > (i) * sizeof(unsigned) ? ((const unsigned *)(set))[i] : 0)
+
+static inline int __wasik_sigtimedwait(const sigset_t *restrict set, siginfo_t *restrict info,
+                                       const struct timespec *restrict timeout) {
+    __wasik_sigattach();
+    int value = 0,
+        sig = __wasi_sigtimedwait(__wasik_sigword(set, 0), __wasik_sigword(set, 1),
+            timeout ? timeout->tv_sec * 1e3 + timeout->tv_nsec * 1e-6 : -1, &value);
+    if (!sig) { errno = EAGAIN; return -1; }
+    if (info) *info = (siginfo_t){.si_signo = sig, .si_value.sival_int = value};
+    return sig;
+}
+
+static inline int __wasik_sigwaitinfo(const sigset_t *restrict set, siginfo_t *restrict info) {
+    return __wasik_sigtimedwait(set, info, 0);
+}
+
+static inline int __wasik_sigwait(const sigset_t *restrict set, int *restrict sig) {
+    __wasik_sigattach();
+    *sig = __wasi_sigtimedwait(__wasik_sigword(set, 0), __wasik_sigword(set, 1), -1, 0);
+    return 0;
+}
+
+/* waits for any signal not in `mask`, and runs its handler (as installed by `signal`) */
+static inline int __wasik_sigsuspend(const sigset_t *mask) {
+    __wasik_sigattach();
+    raise(__wasi_sigtimedwait(~__wasik_sigword(mask, 0), ~__wasik_sigword(mask, 1), -1, 0));
+    errno = EINTR;
+    return -1;
+}
+
+static inline int __wasik_sigpending(sigset_t *set) {
+    __wasik_sigattach();
+    *set = (sigset_t){0};
+    ((unsigned *)set)[0] = __wasi_sigpending();
+    if (sizeof(sigset_t) > sizeof(unsigned))
+        ((unsigned *)set)[1] = __wasi_sigpending_hi();
+    return 0;
+}
+
+/* only to the calling process, for now */
+static inline int __wasik_sigqueue(pid_t pid, int sig, union sigval value) {
+    __wasik_sigattach();
+    if (pid != 0 && pid != getpid()) { errno = ESRCH; return -1; }
+    if (__wasi_sigqueue(sig, value.sival_int) < 0) { errno = EAGAIN; return -1; }
+    return 0;
+}
+
+#define sigtimedwait  __wasik_sigtimedwait
+#define sigwaitinfo   __wasik_sigwaitinfo
+#define sigwait       __wasik_sigwait
+#define sigsuspend    __wasik_sigsuspend
+#define sigpending    __wasik_sigpending
+#define sigqueue      __wasik_sigqueue
+
 #endif
 
 WASI_C_END
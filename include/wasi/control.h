@@ -15,7 +15,7 @@ setjmp_ret_val __control_setjmp_with_return
 
 static inline void
 __control_setjmp_set_return(jmp_buf env, setjmp_ret_val ret_val) {
-#ifdef __wasix__
+#ifdef _WASIK_LIBC_SETJMP
 # define e ((struct __wasik_jmp_buf*)env)[0]
 #else
 # define e env[0]
@@ -195,6 +195,19 @@ class Phase {
                 this.getConfig().asyncify ?? false;
     }
 
+    /**
+     * How setjmp/longjmp are implemented:
+     *  - `"control"` (default) — via the kernel's `__control_setjmp` blocks
+     *    (every jump is a JS exception round trip);
+     *  - `"wasm"` — lowered by LLVM to Wasm exception handling, using the
+     *    `__c_longjmp` tag; jumps stay inside the guest.
+     */
+    sjljMode() {
+        if (WASI_KIT_FLAGS.includes('sjlj=wasm')) return 'wasm';
+        return this.getConfigForCurrent().sjlj ??
+                this.getConfig().sjlj ?? 'control';
+    }
+
     closest(basename, that_has = undefined) {
         var at = '';
         while (fs.realpathSync(at) != '/') {
@@ -336,6 +349,11 @@ class Compile extends Phase {
         return flags;
     }
 
+    getCodegenFlags() {
+        return this.sjljMode() === 'wasm' ?
+            ['-mllvm', '-wasm-enable-sjlj', '-mllvm', '-wasm-use-legacy-eh=false'] : [];
+    }
+
     getLinkFlags(flags, config=undefined) {
         const wasixFlags = (!this.isWasix() || flags['-nostdlib'] || flags['-r']) ? [] : [
             '-pthread', /* required for the `tls` symbols */
@@ -354,6 +372,10 @@ class Compile extends Phase {
         ];
         if (!config?.args?.some(x => x.includes('--max-memory')))
             wasixFlags.push("-Wl,--max-memory=4294967296");
+        if (!(flags['-shared'] || flags['-nostdlib'] || flags['-r']))
+            wasixFlags.push('-Wl,--export-if-defined=malloc');  /* for `Proc.userReturnBuffer` */
+        if (this.sjljMode() === 'wasm' && !(flags['-shared'] || flags['-nostdlib'] || flags['-r']))
+            wasixFlags.push('-lsetjmp');  /* `__wasm_setjmp` & co. from wasi-libc */
         return [...wasixFlags,
                 ...(flags['-shared'] || flags['-nostdlib']) ? []
                     : this.buildStartupLib()];
@@ -373,6 +395,7 @@ class Compile extends Phase {
             patched.unshift(...this.getIncludeFlags());
         if (!flags['-c'])
             patched.unshift(...this.getLinkFlags(flags, wasmOut.config));
+        patched.unshift(...this.getCodegenFlags());
 
         return patched;
     }
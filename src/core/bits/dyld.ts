@@ -1,6 +1,9 @@
-import * as itertools from 'itertools';
 import { Proc, TraceFunc, Trace } from './proc';
-import delegation from './autogen/delegation';
+import { TraceEvent } from './trace';
+import { MemoryView } from './memory';
+import { ModuleCache } from './module-cache';
+import { LibraryIndex } from './ldcache';
+import { Glue } from './glue';
 
 
 
@@ -10,13 +13,38 @@ class DynamicLoader {
 
     dylibTable = new DynamicLibrary.Table
     extern: DynamicLibrary.Relocations
+    modules = ModuleCache.shared
+
+    _funcIndex: DynamicLibrary.FuncTableIndex
+    space = new DynamicLibrary.AddressSpace
 
     constructor(public proc: Proc) { }
 
+    /** Memory and table space taken up by dynamic libraries in this process. */
+    get usage() {
+        return this.space.usage;
+    }
+
+    /** Writes `usage` to the guest as `{memory, table, libraries}` (`uint32_t`s). */
+    dlusage(pout: i32) {
+        let {memory, table, libraries} = this.usage, dv = this.proc.mem;
+        dv.setUint32(pout, memory, true);
+        dv.setUint32(pout + 4, table, true);
+        dv.setUint32(pout + 8, libraries, true);
+        return 0;
+    }
+
+    get funcIndex() {
+        let table = this.proc.funcTable;
+        if (this._funcIndex?.table !== table)
+            this._funcIndex = new DynamicLibrary.FuncTableIndex(table);
+        return this._funcIndex;
+    }
+
     async preload(path: string, uri: string, reloc?: DynamicLibrary.Relocations) {
         if (this.dylibTable.def.has(path)) return;
 
-        let wasm = await WebAssembly.compileStreaming(fetch(uri));
+        let wasm = await this.modules.fetch(uri);
         this.dylibTable.def.set(path, new DynamicLibrary.Def(wasm, reloc, {path, uri}));
     }
 
@@ -24,30 +52,64 @@ class DynamicLoader {
         let def = this.dylibTable.def.get(path);
         if (def) return def;
 
-        let fs = globalThis.fs_hook.fs,
-            fn = path.startsWith('/') ? path : `/usr/lib/${path}`,
-            wasm = new WebAssembly.Module(fs.readFileSync(fn));
-            def = new DynamicLibrary.Def(wasm, reloc, {path, uri: `wasi://${fn}`});
+        let fn = this.locate(path);
+        if (!fn) return undefined;
+        let wasm = this.modules.aliased(fn) ??
+                   this.modules.getSync(globalThis.fs_hook.fs.readFileSync(fn));
+        def = new DynamicLibrary.Def(wasm, reloc, {path, uri: `wasi://${fn}`});
 
         this.dylibTable.def.set(path, def);
         return def;
     }
 
+    libraries?: LibraryIndex
+
+    /**
+     * Full path of a library, looked up by name in the same directories as
+     * the preloader's (see `LibraryIndex`). They are listed once per process,
+     * and again on a miss, in case the library was installed since.
+     */
+    locate(name: string) {
+        let fs = globalThis.fs_hook.fs,
+            scan = () => LibraryIndex.scanSync(dir => fs.readdirSync(dir)),
+            fresh = !this.libraries;
+        this.libraries ??= scan();
+        let fn = this.libraries.resolve(name);
+        if (fn === undefined && !fresh)
+            fn = (this.libraries = scan()).resolve(name);
+        return fn;
+    }
+
     // -----------
     // Loader Part
     // -----------
 
     lastError = 'not found';
 
+    /**
+     * Opening a library that is already open returns the same handle
+     * (and bumps its reference count), as in POSIX.
+     */
     dlopen(path: i32, flags: i32) {
-        var path_str = this.proc.userGetCStringUTF8(path);
-        this.trace(`dlopen("${path_str}", ${flags})`);
+        var path_str = this.proc.userGetCStringUTF8(path),
+            t0 = this.proc.tracer.begin();
+        if (this.trace !== Trace.NOP) this.trace(`dlopen("${path_str}", ${flags})`);
         try {
             var def = this.loadSync(path_str, this.extern);
             if (def) {
-                var instance = def.instantiate(this),
-                    handle = this.dylibTable.ref.size + 1;
-                this.dylibTable.ref.set(handle, {def, instance});
+                var handle = this.dylibTable.handles.get(def);
+                if (handle !== undefined)
+                    this.dylibTable.ref.get(handle).refcount++;
+                else {
+                    var got: i32[] = [];
+                    try { var {instance, region} = def.instantiate(this, {lazy: !!(flags & RTLD_LAZY), got}); }
+                    catch (e) { this.releaseGot(got); throw e; }
+                    handle = this.dylibTable.nextHandle++;
+                    this.dylibTable.ref.set(handle,
+                        {def, instance, region, refcount: 1, symbols: new Map, slots: [], got});
+                    this.dylibTable.handles.set(def, handle);
+                }
+                this.proc.tracer.end(TraceEvent.DLOPEN, t0, handle);
                 return handle;
             }
             else this.lastError = 'not found';
@@ -57,56 +119,158 @@ class DynamicLoader {
     }
 
     dlsym(handle: i32, symbol: i32) {
-        var symbol_str = this.proc.userGetCStringUTF8(symbol);
-        this.trace(`dlsym(${handle}, "${symbol_str}")`);
+        var symbol_str = this.proc.userGetCStringUTF8(symbol),
+            t0 = this.proc.tracer.begin(),
+            ret = this._dlsym(handle, symbol_str);
+        this.proc.tracer.end(TraceEvent.DLSYM, t0, handle, ret);
+        return ret;
+    }
+
+    _dlsym(handle: i32, symbol_str: string) {
+        if (this.trace !== Trace.NOP) this.trace(`dlsym(${handle}, "${symbol_str}")`);
         var ref = this.dylibTable.ref.get(handle);
         if (ref) {
-            /* search in WASM instance */
-            var sym = ref.instance.exports[symbol_str];
-            if (sym && sym instanceof Function) {
-                return this.allocateFunc(sym);
+            var h = ref.symbols.get(symbol_str);
+            if (h === undefined) {
+                h = this._dlsymUncached(ref, symbol_str);
+                if (h) ref.symbols.set(symbol_str, h);
             }
-            /* search in JS imports */
-            var js = ref.def.reloc?.js?.[symbol_str],
-                d = js && this.allocateDelegate(js);
-            if (d !== undefined) return d;
+            return h;
+        }
+        this.lastError = 'invalid handle';
+        return 0;
+    }
+
+    _dlsymUncached(ref: DynamicLibrary.Ref, symbol_str: string) {
+        /* search in WASM instance */
+        var sym = ref.instance.exports[symbol_str];
+        if (sym && sym instanceof Function) {
+            return this.allocateFunc(sym, ref.slots);
         }
-        return 0;  // @todo set error message in dlerror
+        /* search in JS imports */
+        var js = ref.def.reloc?.js?.[symbol_str],
+            d = js && this.allocateDelegate(js);
+        if (d !== undefined) return d;
+        this.lastError = `undefined symbol: ${symbol_str}`;
+        return 0;
     }
 
+    /**
+     * Drops a reference; the last one unloads the library, and its memory
+     * and table regions are recycled by later `dlopen`s.
+     * @todo destructors registered by the library with `__cxa_atexit` are
+     *   not run (and will crash at exit).
+     */
     dlclose(handle: i32) {
-        // do nothing?
+        if (this.trace !== Trace.NOP) this.trace(`dlclose(${handle})`);
+        var ref = this.dylibTable.ref.get(handle);
+        if (!ref) { this.lastError = 'invalid handle'; return -1; }
+        if (--ref.refcount > 0) return 0;
+
+        var {memory, table} = ref.region;
+        this.dylibTable.ref.delete(handle);
+        this.dylibTable.handles.delete(ref.def);
+        for (let slot of ref.slots) {
+            this.funcIndex.clear(slot, slot + 1);
+            this.space.releaseTable(slot, 1);
+        }
+        this.releaseGot(ref.got);
+        this.funcIndex.clear(table.base, table.base + table.size);
+        this.space.releaseTable(table.base, table.size);
+        this.space.releaseMemory(memory.base, memory.size);
+        return 0;
+    }
+
+    dlerror() {
+        return this.proc.userReturnCStringUTF8(this.lastError);
     }
 
     dlerror_get(pbuf: i32) {
         return this.proc.userPendingCStringUTF8(this.lastError, pbuf);        
     }
 
-    allocateFunc(func: Function) {
-        var h = this.proc.funcTable.grow(1);
-        this.proc.funcTable.set(h, func);
-        return h;        
+    /**
+     * Table slot for `func`; allocated on first request.
+     * @param owned collects newly allocated slots (to be freed by `dlclose`)
+     */
+    allocateFunc(func: Function, owned?: i32[]) {
+        var h = this.funcIndex.lookup(func);
+        if (h === undefined) {
+            h = this.space.reserveTable(this.proc.funcTable, 1, 1);
+            this.funcIndex.set(h, func);
+            owned?.push(h);
+        }
+        return h;
     }
 
-    allocateDelegate(func: Function) {
-        var bin = delegation[func.length];
-        if (bin) {
-            var mod = new WebAssembly.Module(new Uint8Array(bin)),
-                inst = new WebAssembly.Instance(mod, {env: {delegate: func}});
-            return this.allocateFunc(<Function>inst.exports['glue']);
+    gotSlots = new Map<i32, number>()   /* slots allocated by `gotFunc` → libraries using them */
+
+    /**
+     * Table slot for a function of the main program whose address a library
+     * imports (`GOT.func`); allocated on first request, and shared by all
+     * libraries that need it. Slots allocated here are counted per library
+     * (in `owned`), and released by `dlclose` once no library uses them.
+     */
+    gotFunc(func: Function, owned: i32[]) {
+        var h = this.funcIndex.lookup(func);
+        if (h === undefined) {
+            h = this.space.reserveTable(this.proc.funcTable, 1, 1);
+            this.funcIndex.set(h, func);
+            this.gotSlots.set(h, 0);
+        }
+        var n = this.gotSlots.get(h);
+        if (n !== undefined) {
+            this.gotSlots.set(h, n + 1);
+            owned.push(h);
+        }
+        return h;
+    }
+
+    releaseGot(owned: i32[]) {
+        for (let slot of owned) {
+            let n = this.gotSlots.get(slot) - 1;
+            if (n > 0) { this.gotSlots.set(slot, n); continue; }
+            this.gotSlots.delete(slot);
+            this.funcIndex.clear(slot, slot + 1);
+            this.space.releaseTable(slot, 1);
         }
-        else {
-            console.warn(`cannot delegate function with ${func.length} arguments:`, func);
+    }
+
+    delegates = new Map<Function, i32>()
+
+    /**
+     * Table slot for a JS function, via a glue module of its signature
+     * (see `Glue.signatureOf`); allocated on first request.
+     */
+    allocateDelegate(func: Function) {
+        var h = this.delegates.get(func);
+        if (h === undefined) {
+            try {
+                h = this.allocateFunc(Glue.shared.wrap(func, Glue.signatureOf(func)));
+                this.delegates.set(func, h);
+            }
+            catch (e) {
+                console.warn(`cannot delegate function:`, func, e);
+            }
         }
+        return h;
     }
 }
 
 
 namespace DynamicLibrary {
 
+    const WASM_PAGE = 1 << 16;
+
+    function alignUp(n: number, align: number) {
+        return Math.ceil(n / align) * align;
+    }
+
     export class Table {
         def: Map<string, Def> = new Map()
         ref: Map<i32, Ref> = new Map()
+        handles: Map<Def, i32> = new Map()    /* libraries currently open */
+        nextHandle = 1
     }
 
     export class Def {
@@ -114,29 +278,59 @@ namespace DynamicLibrary {
         reloc: Relocations
         metadata: {path?: string, uri?: string}
 
+        dylink: DylinkInfo
+
         stackSize: number = 1 << 16    /** @todo */
-        memBlocks: number = 1024       /** @todo */
-        tblSize: number = 1024         /** @todo */
 
         constructor(module: WebAssembly.Module, reloc: Relocations = {}, 
                     metadata: {path?: string, uri?: string} = {}) {
             this.module = module;
             this.reloc = reloc;
             this.metadata = metadata;
+            this.dylink = parseDylink(module);
         }
 
-        instantiate(core: {proc: Proc}) {
-            var instance = core.proc.instance,
-                funcTable = core.proc.funcTable,
-                memory = instance.exports.memory as WebAssembly.Memory,
-                stack_base = memory.buffer.byteLength,
-                mem_base = stack_base + this.stackSize,
-                tbl_base = core.proc.funcTable.length;
+        get needed() { return this.dylink.needed; }
 
-            memory.grow(this.memBlocks);
-            funcTable.grow(this.tblSize);
+        /**
+         * Reserves the library's regions, and links and initializes it there;
+         * if that fails, the regions are given back.
+         * @param opts.got collects the `GOT.func` slots taken (see `DynamicLoader.gotFunc`)
+         */
+        instantiate(core: {proc: Proc, funcIndex: FuncTableIndex, space: AddressSpace,
+                           gotFunc(func: Function, owned: i32[]): i32},
+                    opts: {lazy?: boolean, got?: i32[]} = {}) {
+            var main = core.proc.instance,
+                memory = main.exports.memory as WebAssembly.Memory,
+                {memSize, memAlign, tblSize, tblAlign} = this.dylink,
+                stack_size = alignUp(this.stackSize, 1 << memAlign),
+                stack_base = core.space.reserveMemory(memory, stack_size + memSize, 1 << memAlign),
+                mem_base = stack_base + stack_size,
+                tbl_base: number;
+
+            try {
+                tbl_base = core.space.reserveTable(core.proc.funcTable, tblSize, 1 << tblAlign);
+                var instance = this._instantiate(core, main, mem_base, tbl_base, opts);
+            }
+            catch (e) {  /* (out of table, failed to link, or to initialize) */
+                if (tbl_base !== undefined) {
+                    core.funcIndex.clear(tbl_base, tbl_base + tblSize);
+                    core.space.releaseTable(tbl_base, tblSize);
+                }
+                core.space.releaseMemory(stack_base, stack_size + memSize);
+                throw e;
+            }
+            return {instance, region: {memory: {base: stack_base, size: stack_size + memSize},
+                                       table: {base: tbl_base, size: tblSize}}};
+        }
 
-            var globals = this.globals(this.module, instance, funcTable);
+        _instantiate(core: Parameters<Def['instantiate']>[0], main: WebAssembly.Instance,
+                     mem_base: number, tbl_base: number, opts: Parameters<Def['instantiate']>[1]) {
+            var std = core.proc.importsObj(),
+                memory = main.exports.memory as WebAssembly.Memory,
+                funcTable = core.proc.funcTable,
+                got = opts.got ?? [],
+                globals = this.globals(this.module, main, f => core.gotFunc(f, got));
             var instance = new WebAssembly.Instance(this.module, {
                 env: { 
                     memory: memory,
@@ -144,12 +338,13 @@ namespace DynamicLibrary {
                     __memory_base: mem_base,
                     __table_base: tbl_base,
                     __stack_pointer: this._mkglobal(mem_base), // stack grows down?
-                    ...this.relocTable(this.module, instance, core.proc.importsObj()['env']),
+                    ...this.relocTable(this.module, main, std['env'], opts.lazy),
                 },
-                wasik: core.proc.importsObj()['wasik'],
+                wasik: std['wasik'],
                 ...globals
             });
             this.globalsInit(instance, mem_base, globals['GOT.mem'] || {});
+            core.funcIndex.refresh(tbl_base, tbl_base + this.dylink.tblSize);  // elem segments
 
             const invoke = (func: WebAssembly.ExportValue) => {
                 if (func instanceof Function) func();
@@ -160,26 +355,56 @@ namespace DynamicLibrary {
             return instance;
         }
 
-        relocTable(module: WebAssembly.Module, main: WebAssembly.Instance, std: {[name: string]: any}) {
+        /**
+         * Binds the library's function imports. Symbols found now are bound
+         * directly (a lookup costs next to nothing; an extra JS hop on every
+         * call would not).
+         * @param lazy (`RTLD_LAZY`) symbols not found now are bound to a
+         *   trampoline that looks them up again on first call (e.g. after
+         *   `reloc.js` was filled in), instead of to a stub that warns.
+         */
+        relocTable(module: WebAssembly.Module, main: WebAssembly.Instance, std: {[name: string]: any},
+                   lazy = false) {
             var imports = WebAssembly.Module.imports(module),
-                env = {};
+                env = {}, unresolved = [];
             for (let imp of imports) {
                 if (imp.module == 'env' && imp.kind === 'function') {
-                    var exp = this.reloc.js?.[imp.name]
-                              || main.exports[EM_ALIASES[imp.name] || imp.name]
-                              || std[imp.name];
-                    if (exp instanceof Function)
-                        env[imp.name] = exp;
-                    else {
-                        console.warn('unresolved symbol:', imp, '\nin', this.metadata);
-                        env[imp.name] = () => 0;
-                    }
+                    env[imp.name] = this.resolve(imp.name, main, std) ??
+                        (lazy ? this._trampoline(imp.name, main, std)
+                              : this._unresolved(imp.name, unresolved));
                 }
             }
+            if (unresolved.length > 0)
+                console.warn('unresolved symbols:', unresolved, '\nin', this.metadata);
             return env;
         }
 
-        globals(module: WebAssembly.Module, main: WebAssembly.Instance, table: WebAssembly.Table) {
+        resolve(name: string, main: WebAssembly.Instance, std: {[name: string]: any}): Function {
+            var exp = this.reloc.js?.[name]
+                      || main.exports[EM_ALIASES[name] || name]
+                      || std[name];
+            return exp instanceof Function ? exp : undefined;
+        }
+
+        /**
+         * A Wasm import cannot be re-bound once instantiated, and its arity is
+         * not known here, so calls keep going through this (with the symbol
+         * cached after the first). Only for symbols missing at `dlopen`.
+         */
+        _trampoline(name: string, main: WebAssembly.Instance, std: {[name: string]: any}) {
+            var impl: Function;
+            return (...args: any[]) =>
+                (impl ??= this.resolve(name, main, std) ?? this._unresolved(name))(...args);
+        }
+
+        _unresolved(name: string, report?: string[]) {
+            if (report) report.push(name);
+            else console.warn('unresolved symbol:', name, '\nin', this.metadata);
+            return () => 0;
+        }
+
+        /** @param addr table slot for a function of the main program */
+        globals(module: WebAssembly.Module, main: WebAssembly.Instance, addr: (func: Function) => i32) {
             var imports = WebAssembly.Module.imports(module),
                 g: Globals = {};
             for (let imp of imports) {
@@ -188,7 +413,7 @@ namespace DynamicLibrary {
                     g[imp.module] ??= {};
                     g[imp.module][imp.name] = this._mkglobal(
                         exp instanceof WebAssembly.Global ? exp.value :
-                        exp instanceof Function ? this._funcAddr(exp, table) : undefined);
+                        exp instanceof Function ? addr(exp) : undefined);
                 }
             }
             return g;
@@ -224,23 +449,265 @@ namespace DynamicLibrary {
             return g;
         }
 
-        _funcAddr(func: Function, table: WebAssembly.Table) {
-            return itertools.find(itertools.range(table.length),
-                i => table.get(i) == func);
-        }
-
         _mkglobal(initial: i32 = 0xDEADBEEF) {
             return new WebAssembly.Global({value:'i32', mutable:true}, initial);
         }
     }
 
+    /**
+     * Reverse index of the process' function table (`Function` → slot),
+     * used to resolve `GOT.func` imports in O(1).
+     * Slots are scanned once, lazily; slots filled in by the loader
+     * afterwards are registered via `set` or `refresh`.
+     */
+    export class FuncTableIndex {
+        table: WebAssembly.Table
+        map = new Map<Function, number>()
+        indexed = 0    /* slots below this have been scanned */
+
+        constructor(table: WebAssembly.Table) {
+            this.table = table;
+        }
+
+        lookup(func: Function) {
+            this.refresh(this.indexed, this.table.length);
+            let i = this.map.get(func);
+            return (i !== undefined && this.table.get(i) === func) ? i : undefined;
+        }
+
+        set(i: number, func: Function) {
+            this.table.set(i, func);
+            this.map.set(func, i);
+        }
+
+        /** Empties slots (so that stale pointers trap rather than call unloaded code). */
+        clear(from: number, to: number) {
+            for (let i = from; i < to; i++) {
+                let f = this.table.get(i);
+                if (f && this.map.get(f) === i) this.map.delete(f);
+                this.table.set(i, null);
+            }
+        }
+
+        refresh(from: number, to: number) {
+            to = Math.min(to, this.table.length);
+            for (let i = from; i < to; i++) {
+                let f = this.table.get(i);
+                if (f && !this.map.has(f)) this.map.set(f, i);
+            }
+            this.indexed = Math.max(this.indexed, to);
+        }
+    }
+
+    /**
+     * Sizes as declared by the library's `dylink.0` custom section
+     * (https://github.com/WebAssembly/tool-conventions/blob/main/DynamicLinking.md).
+     * Alignments are log2.
+     */
+    export type DylinkInfo = {
+        memSize: number, memAlign: number,
+        tblSize: number, tblAlign: number,
+        needed: string[]
+    };
+
+    /* defaults for modules that lack a `dylink.0` section */
+    const DYLINK_DEFAULTS: DylinkInfo = {
+        memSize: 1024 * WASM_PAGE, memAlign: 4, tblSize: 1024, tblAlign: 0, needed: []
+    };
+
+    export function parseDylink(module: WebAssembly.Module | Uint8Array): DylinkInfo {
+        var sec = module instanceof WebAssembly.Module
+            ? WebAssembly.Module.customSections(module, 'dylink.0')[0]
+            : customSection(module, 'dylink.0');
+        if (!sec) return {...DYLINK_DEFAULTS};
+
+        var info: DylinkInfo = {memSize: 0, memAlign: 0, tblSize: 0, tblAlign: 0, needed: []},
+            r = new ByteReader(new Uint8Array(sec)),
+            td = new TextDecoder;
+        while (!r.eof) {
+            var type = r.u8(), end = r.leb() + r.pos;
+            switch (type) {
+            case DYLINK_MEM_INFO:
+                info.memSize = r.leb(); info.memAlign = r.leb();
+                info.tblSize = r.leb(); info.tblAlign = r.leb();
+                break;
+            case DYLINK_NEEDED:
+                for (let n = r.leb(); n > 0; n--)
+                    info.needed.push(td.decode(r.bytes(r.leb())));
+                break;
+            }
+            r.pos = end;  /* skip unknown subsections */
+        }
+        return info;
+    }
+
+    const DYLINK_MEM_INFO = 1,
+          DYLINK_NEEDED = 2;
+
+    /**
+     * Finds a custom section in a module binary without compiling it.
+     * Custom sections placed before all others (`dylink.0` must be first)
+     * are found without scanning the whole binary.
+     */
+    export function customSection(bin: Uint8Array, name: string) {
+        var r = new ByteReader(bin), td = new TextDecoder;
+        r.pos = 8;  /* magic + version */
+        while (!r.eof) {
+            var id = r.u8(), end = r.leb() + r.pos;
+            if (id === 0) {
+                var nm = td.decode(r.bytes(r.leb()));
+                if (nm === name) return bin.slice(r.pos, end);
+            }
+            r.pos = end;
+        }
+    }
+
+    class ByteReader {
+        pos = 0
+        constructor(public data: Uint8Array) { }
+        get eof() { return this.pos >= this.data.length; }
+        u8() { return this.data[this.pos++]; }
+        leb() {
+            var v = 0, shift = 0, b: number;
+            do {
+                b = this.data[this.pos++];
+                v += (b & 0x7f) * 2 ** shift;
+                shift += 7;
+            } while (b & 0x80);
+            return v;
+        }
+        bytes(n: number) {
+            return this.data.subarray(this.pos, this.pos += n);
+        }
+    }
+
+    /**
+     * Hands out regions of the process' memory and function table to
+     * libraries, keeping track of how much was reserved.
+     * Regions released by `dlclose` go to free lists and are reused first.
+     * Otherwise, memory can only grow by whole pages, so the tail of the last
+     * page is kept for the next library -- as long as nobody else (i.e. the
+     * guest's `sbrk`, maybe on another thread) grew the memory in between.
+     */
+    export class AddressSpace {
+        memTop = 0          /* end of last reservation */
+        memEnd = 0          /* memory size right after it */
+        free = {memory: new FreeList, table: new FreeList}
+        usage = {memory: 0, table: 0, libraries: 0}
+
+        reserveMemory(memory: WebAssembly.Memory, size: number, align: number) {
+            var base = this.free.memory.take(size, align);
+            if (base !== undefined)
+                MemoryView.of(memory).fill(base, size);  /* .bss */
+            else
+                base = this._extend(memory, size, align);
+            this.usage.memory += size;
+            this.usage.libraries++;
+            return base;
+        }
+
+        /**
+         * Takes new memory at the end. Where the new pages are is known from
+         * what `grow` returns (the size before growing) and nothing else, since
+         * the memory may be grown by another thread at any moment.
+         */
+        _extend(memory: WebAssembly.Memory, size: number, align: number) {
+            var top = this.memTop, end = this.memEnd;
+            while (true) {
+                let base = alignUp(top, align),
+                    pages = Math.ceil(Math.max(0, base + size - end) / WASM_PAGE),
+                    old = memory.grow(pages) * WASM_PAGE;
+                if (old === end) {  /* contiguous with [top, end), which is ours */
+                    this.memTop = base + size;
+                    this.memEnd = end + pages * WASM_PAGE;
+                    return base;
+                }
+                /* grown by someone else since: keep the old tail for later, go on from the new pages */
+                this.free.memory.give(top, end - top);
+                top = old;
+                end = old + pages * WASM_PAGE;
+            }
+        }
+
+        releaseMemory(base: number, size: number) {
+            this.free.memory.give(base, size);
+            this.usage.memory -= size;
+            this.usage.libraries--;
+        }
+
+        reserveTable(table: WebAssembly.Table, size: number, align: number) {
+            var base = this.free.table.take(size, align);
+            if (base === undefined) {
+                base = alignUp(table.length, align);
+                if (base + size > table.length) table.grow(base + size - table.length);
+            }
+            this.usage.table += size;
+            return base;
+        }
+
+        releaseTable(base: number, size: number) {
+            this.free.table.give(base, size);
+            this.usage.table -= size;
+        }
+    }
+
+    export type Region = {base: number, size: number};
+
+    /** First-fit free list; regions are kept sorted and coalesced. */
+    export class FreeList {
+        regions: Region[] = []
+
+        take(size: number, align: number) {
+            if (size === 0) return undefined;
+            for (let k = 0; k < this.regions.length; k++) {
+                let r = this.regions[k], base = alignUp(r.base, align),
+                    end = r.base + r.size;
+                if (base + size <= end) {
+                    let rest: Region[] = [];
+                    if (base > r.base) rest.push({base: r.base, size: base - r.base});
+                    if (base + size < end) rest.push({base: base + size, size: end - base - size});
+                    this.regions.splice(k, 1, ...rest);
+                    return base;
+                }
+            }
+            return undefined;
+        }
+
+        give(base: number, size: number) {
+            if (size === 0) return;
+            let k = this.regions.findIndex(r => r.base > base);
+            if (k < 0) k = this.regions.length;
+            this.regions.splice(k, 0, {base, size});
+            let next = this.regions[k + 1];
+            if (next && base + size === next.base) {
+                this.regions[k].size += next.size;
+                this.regions.splice(k + 1, 1);
+            }
+            let prev = this.regions[k - 1];
+            if (prev && prev.base + prev.size === base) {
+                prev.size += this.regions[k].size;
+                this.regions.splice(k, 1);
+            }
+        }
+
+        get total() {
+            return this.regions.reduce((n, r) => n + r.size, 0);
+        }
+    }
+
     export type Ref = {
         def: Def
         instance?: WebAssembly.Instance
+        region: {memory: Region, table: Region}
+        refcount: number
+        symbols: Map<string, i32>    /* `dlsym` results */
+        slots: i32[]                 /* table slots allocated by `dlsym` */
+        got: i32[]                   /* `GOT.func` slots in use, see `DynamicLoader.gotFunc` */
     };
 
     export type Relocations = {
-        js?: {[sym: string]: Function}
+        /* a `sig` property on a function sets its Wasm signature (see `Glue`) */
+        js?: {[sym: string]: Function & {sig?: string}}
     };
 
 }
@@ -251,6 +718,10 @@ type i32 = number;
 type GlobalsModule = {[name: string]: WebAssembly.Global};
 type Globals = {[module: string]: GlobalsModule};
 
+/* as in `include/dlfcn.h` */
+const RTLD_NOW = 1,
+      RTLD_LAZY = 2;
+
 const EM_GLOBAL_NS = /^GOT[.]/,  /* GOT.mem & GOT.func */
       EM_ALIASES = {fiprintf: 'fprintf'};
 
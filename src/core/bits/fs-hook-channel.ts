@@ -0,0 +1,156 @@
+import { waitAsync } from './wait-async';
+
+/**
+ * Request/response channel in shared memory for the filesystem hook: a
+ * worker (the client) blocks in `call` while the main thread (the server)
+ * runs the hook action. Created once per worker and registered with the main
+ * thread by a single message; after that, requests take no messages at all.
+ * The answer is a status only; hook actions fill the filesystem, which is
+ * where the worker finds their results.
+ *
+ * `ctl` (`Int32Array`): `[BELL]`, bumped by clients on every request (the
+ * word the server waits on); `[CLOSED]`, set once the worker is gone; then
+ * `SLOTS` slots of `[STATE, OP, STATUS]`.
+ * A slot goes `FREE` -> `CLAIMED` (client) -> `PENDING` -> `RUNNING` (server)
+ * -> `DONE` -> `FREE` (client). Several clients may share a channel; the server
+ * takes up all pending requests in one wakeup.
+ */
+class FsHookChannel {
+    ctl: Int32Array
+
+    constructor(props: FsHookChannelProps) {
+        this.ctl = props.ctl;
+    }
+
+    static create() {
+        return new FsHookChannel({
+            ctl: new Int32Array(new SharedArrayBuffer(4 * (HEADER_SIZE + SLOTS * SLOT_SIZE)))
+        });
+    }
+
+    to(): FsHookChannelProps {
+        return {ctl: this.ctl};
+    }
+
+    get closed() {
+        return Atomics.load(this.ctl, CLOSED) !== 0;
+    }
+
+    /** Marks the client as gone, which ends `serve`. */
+    close() {
+        Atomics.store(this.ctl, CLOSED, 1);
+        Atomics.add(this.ctl, BELL, 1);
+        Atomics.notify(this.ctl, BELL);
+    }
+
+    // - client side -
+
+    /**
+     * Sends a request and blocks until it is served.
+     * @returns a WASI errno; 0 for success
+     */
+    call(op: number) {
+        let s = this._claim(), c = this.ctl;
+        c[s + OP] = op;
+        Atomics.store(c, s + STATE, PENDING);
+        Atomics.add(c, BELL, 1);
+        Atomics.notify(c, BELL);
+
+        for (let st: number; (st = Atomics.load(c, s + STATE)) !== DONE; )
+            Atomics.wait(c, s + STATE, st);
+
+        let status = c[s + STATUS];
+        Atomics.store(c, s + STATE, FREE);
+        Atomics.notify(c, s + STATE);
+        return status;
+    }
+
+    _claim() {
+        while (true) {
+            for (let i = 0; i < SLOTS; i++) {
+                let s = this._slot(i);
+                if (Atomics.compareExchange(this.ctl, s + STATE, FREE, CLAIMED) === FREE)
+                    return s;
+            }
+            /* all taken (by as many threads); wait for the first one to free up */
+            let s = this._slot(0), st = Atomics.load(this.ctl, s + STATE);
+            if (st !== FREE) Atomics.wait(this.ctl, s + STATE, st, CLAIM_RETRY_MS);
+        }
+    }
+
+    // - server side -
+
+    /**
+     * Serves requests with `handler`, until stopped or closed. A handler that
+     * throws fails the request with its `errno` (or `EIO`).
+     * @param onEnd called when serving ends
+     * @returns a function that stops serving
+     */
+    serve(handler: (op: number) => Promise<unknown>, onEnd?: () => void) {
+        let active = true;
+        (async () => {
+            await undefined;  /* (`onEnd` is never called before `serve` returns) */
+            while (active && !this.closed) {
+                let seq = Atomics.load(this.ctl, BELL), n = 0;
+                for (let i = 0; i < SLOTS; i++) {
+                    let s = this._slot(i);
+                    if (Atomics.compareExchange(this.ctl, s + STATE, PENDING, RUNNING) === PENDING) {
+                        this._run(s, handler);  /* not awaited: runs alongside the rest of the batch */
+                        n++;
+                    }
+                }
+                if (n === 0) await waitAsync(this.ctl, BELL, seq);
+            }
+            onEnd?.();
+        })();
+        return () => {
+            active = false;
+            Atomics.add(this.ctl, BELL, 1);
+            Atomics.notify(this.ctl, BELL);
+        };
+    }
+
+    async _run(s: number, handler: (op: number) => Promise<unknown>) {
+        let c = this.ctl, status = 0;
+        try {
+            await handler(c[s + OP]);
+        }
+        catch (e) {
+            status = typeof e?.errno === 'number' ? Math.abs(e.errno) : EIO;
+        }
+        c[s + STATUS] = status;
+        Atomics.store(c, s + STATE, DONE);
+        Atomics.notify(c, s + STATE);
+    }
+
+    _slot(i: number) {
+        return HEADER_SIZE + i * SLOT_SIZE;
+    }
+}
+
+
+type FsHookChannelProps = {ctl: Int32Array};
+
+const BELL = 0,
+      CLOSED = 1,
+      HEADER_SIZE = 2;
+
+const STATE = 0,
+      OP = 1,
+      STATUS = 2,
+      SLOT_SIZE = 3;
+
+const FREE = 0,
+      CLAIMED = 1,
+      PENDING = 2,
+      RUNNING = 3,
+      DONE = 4;
+
+const SLOTS = 8;
+
+const EIO = 29;
+
+const CLAIM_RETRY_MS = 10;
+
+
+export { FsHookChannel, FsHookChannelProps }
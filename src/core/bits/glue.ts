@@ -0,0 +1,95 @@
+/**
+ * Small Wasm modules that are used as glue code when a JS callback is
+ * dynamically requested from a Wasm instance, e.g. via `dlsym`.
+ * (A JS function cannot be placed in a `funcref` table directly.)
+ *
+ * Signatures are strings in the Emscripten style: the result type followed
+ * by parameter types, each one of `v` (void; result only), `i` (i32),
+ * `j` (i64), `f` (f32), `d` (f64). E.g. `"vij"` is `void (i32, i64)`.
+ *
+ * The binary of each signature is encoded directly (no assembler needed),
+ * and compiled once per worker; instantiating it with a delegate is cheap.
+ */
+class Glue {
+    modules = new Map<string, WebAssembly.Module>()
+
+    module(sig: string) {
+        let mod = this.modules.get(sig);
+        if (!mod) this.modules.set(sig, mod = new WebAssembly.Module(Glue.encode(sig)));
+        return mod;
+    }
+
+    /** Wraps a JS function as a Wasm function of signature `sig`. */
+    wrap(func: Function, sig: string) {
+        let inst = new WebAssembly.Instance(this.module(sig), {env: {delegate: func}});
+        return inst.exports['glue'] as Function;
+    }
+
+    /**
+     * Default signature for a JS function: all-i32, by arity.
+     * Can be overridden by setting a `sig` property on the function.
+     */
+    static signatureOf(func: Function & {sig?: string}) {
+        return func.sig ?? 'i' + 'i'.repeat(func.length);
+    }
+
+    /**
+     * Generates a module that imports `env.delegate` and re-exports it
+     * as `glue`, forwarding all arguments.
+     */
+    static encode(sig: string) {
+        let [ret, ...params] = [...sig].map(c => {
+                if (!(c in VALTYPES)) throw new Error(`invalid signature '${sig}'`);
+                return VALTYPES[c];
+            }),
+            results = ret === undefined || ret === VOID ? [] : [ret];
+        if (params.includes(VOID)) throw new Error(`invalid signature '${sig}'`);
+
+        let type = [0x60, ...vec(params), ...vec(results)],
+            body = [0x00 /* no locals */,
+                    ...params.flatMap((_, i) => [0x20 /* local.get */, ...uleb(i)]),
+                    0x10, 0x00 /* call $delegate */, 0x0b /* end */];
+
+        return new Uint8Array([
+            0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+            ...section(1, vec([type])),
+            ...section(2, vec([[...name('env'), ...name('delegate'), 0x00, 0x00]])),
+            ...section(3, vec([[0x00]])),
+            ...section(7, vec([[...name('glue'), 0x00, 0x01]])),
+            ...section(10, vec([[...uleb(body.length), ...body]]))
+        ]);
+    }
+
+    static shared = new Glue
+}
+
+
+const VOID = -1,
+      VALTYPES = {v: VOID, i: 0x7f, j: 0x7e, f: 0x7d, d: 0x7c};
+
+function uleb(n: number) {
+    let out = [];
+    do {
+        let b = n & 0x7f;
+        n >>>= 7;
+        out.push(n ? b | 0x80 : b);
+    } while (n);
+    return out;
+}
+
+/** a vector of items, each either a single byte or an encoded entry */
+function vec(items: (number | number[])[]) {
+    return [...uleb(items.length), ...items.flat()];
+}
+
+function name(s: string) {
+    let bytes = [...new TextEncoder().encode(s)];
+    return [...uleb(bytes.length), ...bytes];
+}
+
+function section(id: number, content: number[]) {
+    return [id, ...uleb(content.length), ...content];
+}
+
+
+export { Glue }
@@ -0,0 +1,100 @@
+import { DynamicLibrary } from './dyld';
+import { ModuleCache } from './module-cache';
+
+
+/**
+ * An `ld.so.cache`-style index of the shared libraries available to a
+ * process: library name → full path. Built from a single listing of the
+ * library directories, so that resolving a name does not probe the filesystem.
+ */
+class LibraryIndex {
+    entries = new Map<string, string>()
+
+    add(name: string, path: string) {
+        if (!this.entries.has(name)) this.entries.set(name, path);  // first dir wins
+        return this;
+    }
+
+    resolve(name: string) {
+        return name.startsWith('/') ? name : this.entries.get(name);
+    }
+
+    has(names: string[]) {
+        return names.every(name => this.resolve(name) !== undefined);
+    }
+
+    static async scan(readdir: (dir: string) => Promise<string[]>, dirs = LIBRARY_PATH) {
+        let index = new LibraryIndex;
+        for (let dir of dirs) {
+            try { index._addDir(dir, await readdir(dir)); }
+            catch { /* directory does not exist */ }
+        }
+        return index;
+    }
+
+    /** Same, with a synchronous `readdir` (for `DynamicLoader`, in the guest's own worker). */
+    static scanSync(readdir: (dir: string) => string[], dirs = LIBRARY_PATH) {
+        let index = new LibraryIndex;
+        for (let dir of dirs) {
+            try { index._addDir(dir, readdir(dir)); }
+            catch { }
+        }
+        return index;
+    }
+
+    _addDir(dir: string, filenames: string[]) {
+        for (let fn of filenames)
+            if (fn.endsWith('.so')) this.add(fn, `${dir}/${fn}`);
+    }
+}
+
+
+/**
+ * Fetches and compiles the transitive closure of the libraries needed by a
+ * program, concurrently, ahead of time. Compiled modules land in the
+ * module cache, where `DynamicLoader.loadSync` will find them.
+ * @param roots names of libraries needed by the program (from its `dylink.0`,
+ *   plus any known to be `dlopen`ed)
+ * @param read reads a library binary
+ * @returns the libraries that were found, by name
+ */
+async function preloadDependencies(roots: string[], index: LibraryIndex,
+                                   read: (path: string) => Promise<Uint8Array>,
+                                   cache = ModuleCache.shared) {
+    let visited = new Map<string, Promise<WebAssembly.Module>>();
+
+    async function visit(name: string) {
+        let path = index.resolve(name);
+        if (!path) { console.warn(`[ld] library not found: ${name}`); return; }
+
+        let mod = await cache.get(await read(path));
+        cache.alias(path, mod);
+        /* not awaited, so that a cycle among libraries does not wait on itself */
+        DynamicLibrary.parseDylink(mod).needed.forEach(enqueue);
+        return mod;
+    }
+
+    function enqueue(name: string) {
+        if (!visited.has(name)) visited.set(name, visit(name));
+    }
+
+    roots.forEach(enqueue);
+    /* until no visit adds any more */
+    for (let n = 0; n !== visited.size; ) {
+        n = visited.size;
+        await Promise.all(visited.values());
+    }
+
+    let found = new Map<string, WebAssembly.Module>();
+    for (let [name, p] of visited) {
+        let mod = await p;
+        if (mod) found.set(name, mod);
+    }
+    return found;
+}
+
+
+const LIBRARY_PATH = ['/usr/lib', '/usr/local/lib', '/lib'];
+
+
+export { LibraryIndex, preloadDependencies }
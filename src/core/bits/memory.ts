@@ -0,0 +1,117 @@
+/**
+ * Cached typed views over a Wasm linear memory.
+ * Views are only re-created when the underlying buffer changes, i.e.
+ * after `memory.grow` (which detaches a non-shared buffer and replaces
+ * a shared one), so syscall helpers do not allocate on the hot path.
+ */
+class MemoryView {
+    memory: WebAssembly.Memory
+
+    _buffer: ArrayBufferLike
+    _dv: DataView
+    _u8: Uint8Array
+
+    private td = new TextDecoder();
+    private te = new TextEncoder();
+
+    constructor(memory: WebAssembly.Memory) {
+        this.memory = memory;
+    }
+
+    static cache = new WeakMap<WebAssembly.Memory, MemoryView>()
+
+    /** The (shared) view for a given memory. */
+    static of(memory: WebAssembly.Memory) {
+        let v = this.cache.get(memory);
+        if (!v) this.cache.set(memory, v = new MemoryView(memory));
+        return v;
+    }
+
+    get dv(): DataView {
+        this._refresh();
+        return this._dv;
+    }
+
+    get u8(): Uint8Array {
+        this._refresh();
+        return this._u8;
+    }
+
+    get byteLength() {
+        return this.u8.byteLength;
+    }
+
+    /**
+     * Re-creates views if the buffer was replaced or detached.
+     * A growable `SharedArrayBuffer` can also grow in-place, in which case
+     * the identity is unchanged but the views would be stale.
+     */
+    _refresh() {
+        let buf = this.memory.buffer;
+        if (buf !== this._buffer || buf.byteLength !== this._u8.byteLength) {
+            this._buffer = buf;
+            this._dv = new DataView(buf);
+            this._u8 = new Uint8Array(buf);
+        }
+    }
+
+    // ------------
+    // Bulk Access
+    // ------------
+
+    /** Copies `len` bytes out of guest memory. */
+    read(ptr: i32, len: number) {
+        return this.u8.slice(ptr, ptr + len);
+    }
+
+    /** Copies `data` into guest memory at `ptr`. */
+    write(ptr: i32, data: Uint8Array) {
+        this.u8.set(data, ptr);
+    }
+
+    /** Sets `len` bytes at `ptr` to `value`. */
+    fill(ptr: i32, len: number, value = 0) {
+        this.u8.fill(value, ptr, ptr + len);
+    }
+
+    /**
+     * Length of a NUL-terminated string, scanning at most `maxLen` bytes.
+     * Returns `maxLen` (or up to the end of memory) if no NUL was found.
+     */
+    strlen(ptr: i32, maxLen = MAX_CSTRING) {
+        let u8 = this.u8, end = Math.min(ptr + maxLen, u8.byteLength);
+        for (let i = ptr; i < end; i++)
+            if (u8[i] === 0) return i - ptr;
+        return end - ptr;
+    }
+
+    getCString(ptr: i32, maxLen = MAX_CSTRING) {
+        return this.read(ptr, this.strlen(ptr, maxLen));
+    }
+
+    getCStringUTF8(ptr: i32, maxLen = MAX_CSTRING) {
+        /* decode from a copy; `TextDecoder` rejects shared buffers */
+        return this.td.decode(this.getCString(ptr, maxLen));
+    }
+
+    /**
+     * Writes a NUL-terminated UTF-8 string at `ptr`, truncating to `cap` bytes
+     * (including the terminator).
+     * @returns number of bytes written, not including the NUL
+     */
+    setCStringUTF8(ptr: i32, s: string, cap: number) {
+        if (cap <= 0) return 0;
+        let { written } = this.te.encodeInto(s, this.u8.subarray(ptr, ptr + cap - 1));
+        this.u8[ptr + written] = 0;
+        return written;
+    }
+}
+
+
+type i32 = number;
+
+/** Upper bound for NUL scans (guards against runaway reads of garbage pointers). */
+const MAX_CSTRING = 1 << 20;
+
+
+export { MemoryView }
@@ -0,0 +1,295 @@
+const MODULE_CHANNEL = 'wasik-modules',
+      PERSISTENT_CACHE = 'wasik-modules-v2';
+
+
+type ModuleCacheLimits = {
+    modules: number     /* compiled modules kept in memory */
+    libraries: number   /* preloaded libraries kept by path */
+};
+
+const DEFAULT_LIMITS: ModuleCacheLimits = {modules: 64, libraries: 256};
+
+
+/** A `Map` that keeps at most `limit` entries, dropping the least recently used. */
+class LruMap<K, V> extends Map<K, V> {
+    constructor(public limit: number) { super(); }
+
+    get(key: K) {
+        let value = super.get(key);
+        if (value !== undefined) { super.delete(key); super.set(key, value); }
+        return value;
+    }
+
+    set(key: K, value: V) {
+        super.delete(key);
+        super.set(key, value);
+        for (let oldest of this.keys()) {
+            if (this.size <= this.limit) break;
+            this.delete(oldest);
+        }
+        return this;
+    }
+}
+
+
+/**
+ * Cache of compiled Wasm modules, keyed by the SHA-256 of their content
+ * (`contentKey`): a collision would run the wrong program, so a fast hash
+ * will not do.
+ *
+ * Tiers:
+ *  - in-memory, per worker, bounded by `limits` (the least recently used go
+ *    first); modules compiled by one worker are posted to the others on a
+ *    `BroadcastChannel` (engines that refuse to clone modules on a broadcast
+ *    channel just skip this step).
+ *    Workers started after the fact miss those posts; they get the preloaded
+ *    libraries (`byPath`) with their init message instead, see `worker.ts`;
+ *  - persistent, in Cache Storage, where available, under the same key.
+ *    Entries are re-compiled with `compileStreaming`, which lets the browser
+ *    use its own code cache.
+ * Synchronous lookups (`getSync`) can only use the in-memory tier.
+ */
+class ModuleCache {
+    limits: ModuleCacheLimits
+    mem: LruMap<string, WebAssembly.Module>
+    byPath: LruMap<string, WebAssembly.Module>   /* preloaded library files */
+    stats = {hits: 0, persistentHits: 0, misses: 0, compileMs: 0,
+             aliasHits: 0, aliasMisses: 0}
+    compileTimes: LruMap<string, number>
+
+    chan?: BroadcastChannel
+
+    constructor(limits: Partial<ModuleCacheLimits> = {}) {
+        this.limits = {...DEFAULT_LIMITS, ...limits};
+        this.mem = new LruMap(this.limits.modules);
+        this.byPath = new LruMap(this.limits.libraries);
+        this.compileTimes = new LruMap(this.limits.modules);
+    }
+
+    listen() {
+        if (this.chan || typeof BroadcastChannel === 'undefined') return this;
+        this.chan = new BroadcastChannel(MODULE_CHANNEL);
+        this.chan.addEventListener('message', ({data}) => {
+            if (!(data.module instanceof WebAssembly.Module)) return;
+            switch (data.type) {
+            case 'module': this.mem.set(data.key, data.module); break;
+            case 'alias': this.byPath.set(data.path, data.module); break;
+            }
+        });
+        return this;
+    }
+
+    getSync(bytes: Uint8Array, info: LookupInfo = {}) {
+        let key = info.key = sha256(bytes),
+            mod = this.mem.get(key);
+        if (mod) { this.stats.hits++; info.hit = true; return mod; }
+
+        this.stats.misses++;
+        let start = performance.now();
+        mod = new WebAssembly.Module(bytes);
+        this._compiled(key, info.compileMs = performance.now() - start);
+        this.add(key, mod);
+        info.bytesCopied = this.persist(bytes, key);
+        return mod;
+    }
+
+    /** @param info receives the key, and whether (or how long it took) to compile */
+    async get(bytes: Uint8Array, info: LookupInfo = {}) {
+        let src = unshared(bytes), subtle = !!globalThis.crypto?.subtle,
+            key = info.key = await contentKey(src),
+            mod = this.mem.get(key);
+        /* (`digest` takes a copy) */
+        info.bytesCopied = (src !== bytes ? bytes.length : 0) + (subtle ? bytes.length : 0);
+        if (mod) { this.stats.hits++; info.hit = true; return mod; }
+
+        let start = performance.now();
+        if (mod = this.persistent && await this.fromPersistent(key))
+            this.stats.persistentHits++;
+        else {
+            this.stats.misses++;
+            mod = await WebAssembly.compile(src);
+            info.bytesCopied += this.persist(src, key);
+        }
+        this._compiled(key, info.compileMs = performance.now() - start);
+        this.add(key, mod);
+        return mod;
+    }
+
+    /**
+     * The module with content key `key`, from either tier, if it is there;
+     * for callers that know the key without the bytes (see `System._module`).
+     */
+    async getByKey(key: string, info: LookupInfo = {}) {
+        info.key = key;
+        let mod = this.mem.get(key);
+        if (mod) { this.stats.hits++; info.hit = true; return mod; }
+
+        let start = performance.now();
+        if (mod = this.persistent && await this.fromPersistent(key)) {
+            this.stats.persistentHits++;
+            this._compiled(key, info.compileMs = performance.now() - start);
+            this.add(key, mod);
+        }
+        return mod;
+    }
+
+    /** How long it took to compile a module, i.e. what a hit saves. */
+    compileTime(key: string) {
+        return this.compileTimes.get(key) ?? 0;
+    }
+
+    _compiled(key: string, ms: number) {
+        this.stats.compileMs += ms;
+        this.compileTimes.set(key, ms);
+    }
+
+    async fetch(uri: string) {
+        return this.get(new Uint8Array(await (await fetch(uri)).arrayBuffer()));
+    }
+
+    add(key: string, mod: WebAssembly.Module) {
+        this.mem.set(key, mod);
+        try { this.chan?.postMessage({type: 'module', key, module: mod}); }
+        catch { /* module not cloneable over this channel */ }
+    }
+
+    /**
+     * Registers `mod` as the content of the file at `path`, so that it can be
+     * loaded without reading the file again. For preloaded libraries, which
+     * are assumed not to change during a session.
+     */
+    alias(path: string, mod: WebAssembly.Module) {
+        this.byPath.set(path, mod);
+        try { this.chan?.postMessage({type: 'alias', path, module: mod}); }
+        catch { }
+    }
+
+    /** The preloaded library at `path`, if any; `stats.alias*` count how often there was one. */
+    aliased(path: string) {
+        let mod = this.byPath.get(path);
+        if (mod) this.stats.aliasHits++; else this.stats.aliasMisses++;
+        return mod;
+    }
+
+    /** (needs Cache Storage, which is for secure contexts only) */
+    get persistent() {
+        return typeof caches !== 'undefined';
+    }
+
+    /** @param pkey a key from `contentKey` */
+    async fromPersistent(pkey: string) {
+        try {
+            let store = await this.store(),
+                res = await store?.match(this._url(pkey));
+            return res && await WebAssembly.compileStreaming(res);
+        }
+        catch { return undefined; }
+    }
+
+    /**
+     * Writes an entry to the persistent tier, in the background.
+     * @returns the number of bytes copied for it: `Response` takes a copy of
+     *   what it is given, and cannot be given shared memory directly
+     */
+    persist(bytes: Uint8Array, pkey: string) {
+        if (!this.persistent) return 0;
+        let src = unshared(bytes),
+            res = new Response(src, {headers: {'Content-Type': 'application/wasm'}});
+        this._put(pkey, res);
+        return (src !== bytes ? bytes.length : 0) + bytes.length;
+    }
+
+    async _put(pkey: string, res: Response) {
+        try {
+            let store = await this.store();
+            await store?.put(this._url(pkey), res);
+        }
+        catch (e) { console.warn('[module-cache] persist failed;', e); }
+    }
+
+    _store: Promise<Cache | undefined>
+
+    store() {
+        return this._store ??= (typeof caches !== 'undefined' ?
+            caches.open(PERSISTENT_CACHE).catch(() => undefined) : Promise.resolve(undefined));
+    }
+
+    _url(key: string) {
+        return `/.wasik/modules/${key}.wasm`;
+    }
+
+    static shared = new ModuleCache().listen()
+}
+
+
+type LookupInfo = {key?: string, hit?: boolean, compileMs?: number, bytesCopied?: number};
+
+/**
+ * SHA-256 of the content, in hex. Through `crypto.subtle` where there is one
+ * (secure contexts), which is faster even though it takes a copy.
+ */
+async function contentKey(bytes: Uint8Array) {
+    if (!globalThis.crypto?.subtle) return sha256(bytes);
+    let digest = new Uint8Array(await crypto.subtle.digest('SHA-256', unshared(bytes)));
+    return Array.from(digest, b => b.toString(16).padStart(2, '0')).join('');
+}
+
+/** SHA-256 in hex, computed here; for synchronous lookups (`getSync`). */
+function sha256(bytes: Uint8Array) {
+    let h = Uint32Array.from(SHA256_INIT), w = new Int32Array(64),
+        n = bytes.length, full = n - n % 64,
+        tail = new Uint8Array(n - full < 56 ? 64 : 128);
+    for (let at = 0; at < full; at += 64) sha256Block(h, w, bytes, at);
+
+    tail.set(bytes.subarray(full));
+    tail[n - full] = 0x80;
+    let dv = new DataView(tail.buffer);
+    dv.setUint32(tail.length - 8, Math.floor(n / 0x20000000));  /* length in bits, big-endian */
+    dv.setUint32(tail.length - 4, (n << 3) >>> 0);
+    for (let at = 0; at < tail.length; at += 64) sha256Block(h, w, tail, at);
+
+    return Array.from(h, x => x.toString(16).padStart(8, '0')).join('');
+}
+
+function sha256Block(h: Uint32Array, w: Int32Array, data: Uint8Array, at: number) {
+    for (let i = 0; i < 16; i++, at += 4)
+        w[i] = data[at] << 24 | data[at + 1] << 16 | data[at + 2] << 8 | data[at + 3];
+    for (let i = 16; i < 64; i++) {
+        let x = w[i - 15], y = w[i - 2];
+        w[i] = ((x >>> 7 | x << 25) ^ (x >>> 18 | x << 14) ^ x >>> 3) +
+               ((y >>> 17 | y << 15) ^ (y >>> 19 | y << 13) ^ y >>> 10) + w[i - 7] + w[i - 16] | 0;
+    }
+    let a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (let i = 0; i < 64; i++) {
+        let t1 = k + ((e >>> 6 | e << 26) ^ (e >>> 11 | e << 21) ^ (e >>> 25 | e << 7)) +
+                 (e & f ^ ~e & g) + SHA256_K[i] + w[i] | 0,
+            t2 = ((a >>> 2 | a << 30) ^ (a >>> 13 | a << 19) ^ (a >>> 22 | a << 10)) +
+                 (a & b ^ a & c ^ b & c) | 0;
+        k = g; g = f; f = e; e = d + t1 | 0;
+        d = c; c = b; b = a; a = t1 + t2 | 0;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+const SHA256_INIT = [
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+];
+
+const SHA256_K = Int32Array.from([
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+]);
+
+/** `bytes`, or a copy if they are in shared memory (which Web APIs do not take). */
+function unshared(bytes: Uint8Array) {
+    return bytes.buffer instanceof ArrayBuffer ? bytes : bytes.slice();
+}
+
+export { ModuleCache, ModuleCacheLimits, LookupInfo, LruMap, contentKey, sha256 }
@@ -1,4 +1,7 @@
 import { DynamicLoader } from "./dyld";
+import { MemoryView } from "./memory";
+import { Tracer, TraceEvent } from "./trace";
+import { SignalVector, SignalTable } from "./signals";
 
 
 class Proc {
@@ -8,17 +11,21 @@ class Proc {
     trace = {
         syscalls: Trace.NOP
     }
+    tracer = Tracer.local
 
     _imports?: {[ns: string]: {[name: string]: any}}
     _funcTable: WebAssembly.Table = undefined
+    _sigvec?: SignalVector
 
     imports(): [string, [string, any][]][] {
         let bind = (o: object, l: string[]) => l.map(method => [method, o[method].bind(o)] as [string, any]);
         return [
             ['env', bind(this, ['__control_setjmp', '__control_setjmp_with_return',
                                 '__control_longjmp'])],
-            ['wasik', bind(this.dyld, ['dlopen', 'dlsym', 'dlclose', 'dlerror_get']).concat(
-                      bind(this, ['login_get', 'progname_get', 'sorry']))]
+            ['wasik', bind(this.dyld, ['dlopen', 'dlsym', 'dlclose', 'dlerror', 'dlerror_get', 'dlusage']).concat(
+                      bind(this, ['login', 'progname', 'login_get', 'progname_get', 'sorry',
+                                  'sigattach', 'sigpending', 'sigpending_hi', 'sigraise',
+                                  'sigqueue', 'sigtimedwait']))]
         ];
     }
 
@@ -31,8 +38,12 @@ class Proc {
         return this.instance.exports.memory as WebAssembly.Memory;
     }
 
+    get memView(): MemoryView {
+        return MemoryView.of(this._mem);
+    }
+
     get mem(): DataView {
-        return new DataView(this._mem.buffer);
+        return this.memView.dv;
     }
 
     get funcTable(): WebAssembly.Table {
@@ -65,19 +76,25 @@ class Proc {
         return this.__control_longjmp(env, val);
     }
 
+    /**
+     * JS fallback for setjmp/longjmp: the block is re-entered every time a
+     * matching `Longjmp` is caught.
+     * Programs compiled with wasi-kit's `"sjlj": "wasm"` do not get here at all;
+     * their jumps are Wasm exceptions tagged `__c_longjmp`, and stay in the guest.
+     */
     __control_setjmp(env: i32, block: i32) {
-        this.trace.syscalls(`__control_setjmp [${env}, ${block}]`);
         this.mem.setUint32(env, 0);  // set jmpbuf[0].ret = 0
-        let impl = this.blockImpl(block), val = 0;
+        let impl = this.blockFunc(block), val = 0;
         try {
             while (true) {
                 try {
-                    return impl(val);
+                    return impl(block, val);
                 }
                 catch (e) {
-                    this.debug(`setjmp caught ${JSON.stringify(e)}`);
-                    if (e instanceof Longjmp && e.env == env)
+                    if (e instanceof Longjmp && e.env == env) {
+                        this.tracer.end(TraceEvent.LONGJMP, e.t0, env, e.val);
                         val = e.val;
+                    }
                     else
                         throw e;
                 }
@@ -93,8 +110,7 @@ class Proc {
     }
 
     __control_longjmp(env: i32, val: i32) {
-        this.trace.syscalls(`__control_longjmp [${env}] ${val}`);
-        throw new Longjmp(env, val);
+        throw new Longjmp(env, val, this.tracer.begin());
     }
 
     /**
@@ -102,14 +118,31 @@ class Proc {
      * @param block a C block pointer
      */
     blockImpl(block: i32) {
-        let impl = this.funcTable.get(
-            this.mem.getUint32(block + 12, true));
-        //console.warn(this.mem.getUint32(block + 12, true), impl);
+        let impl = this.blockFunc(block);
         return (...args: any) => impl(block, ...args);
     }
 
+    /**
+     * The block's invoke function; it has to be called with the block
+     * pointer as its first argument.
+     * @param block a C block pointer
+     */
+    blockFunc(block: i32): Function {
+        return this.funcTable.get(this.mem.getUint32(block + 12, true));
+    }
+
     //  ---
 
+    progname() {
+        return this.userReturnCStringUTF8('progname');
+    }
+
+    login() {
+        return this.userReturnCStringUTF8('user');
+    }
+
+    /* legacy (two-phase) variants, see `sorry` */
+
     progname_get(pbuf: i32) {
         return this.userPendingCStringUTF8('progname', pbuf);
     }
@@ -118,31 +151,105 @@ class Proc {
         return this.userPendingCStringUTF8('user', pbuf);
     }    
 
+    // ------------
+    // Signals Part
+    // ------------
+
+    /**
+     * The process' signal vector, shared by all of its threads once they have
+     * joined it (`sigattach`). Until then, or for processes not started by
+     * the init process, each thread has one of its own.
+     */
+    get sigvec(): SignalVector {
+        return this._sigvec ??= new SignalVector;
+    }
+
+    /**
+     * Joins the vector at `slot` of `SignalTable.shared`. Called by the guest
+     * (once per thread, see `include/signal.h`) with the slot that the init
+     * process put in its environment (`SIGVEC_ENV`).
+     */
+    sigattach(slot: i32) {
+        let table = SignalTable.shared;
+        if (table && 0 <= slot && slot < table.capacity)
+            this._sigvec = table.vector(slot);
+    }
+
+    /** Bitmask of pending signals; cheap enough to poll in a loop. */
+    sigpending() {
+        return this.sigvec.pending;
+    }
+
+    /** Same, for signals 33-64 (bit `signum - 33`). */
+    sigpending_hi() {
+        return this.sigvec.pendingHi;
+    }
+
+    sigraise(signum: i32) {
+        return this.sigvec.send(signum) ? 0 : -1;
+    }
+
+    /** @returns -1 if the queue is full */
+    sigqueue(signum: i32, value: i32) {
+        return this.sigvec.queue(signum, value) ? 0 : -1;
+    }
+
+    /**
+     * Blocks until a signal in the mask is pending, and takes it.
+     * @param timeout in milliseconds; negative means forever
+     * @param pvalue if non-null, receives the signal's payload
+     * @returns the signal number, or 0 on timeout
+     */
+    sigtimedwait(mask: i32, maskHi: i32, timeout: number, pvalue: i32) {
+        let t0 = this.tracer.begin(),
+            signum = this.sigvec.wait(mask, timeout < 0 ? Infinity : timeout, maskHi);
+        if (signum && pvalue) this.mem.setInt32(pvalue, this.sigvec.value, true);
+        this.tracer.end(TraceEvent.SIGWAIT, t0, mask, signum);
+        return signum;
+    }
+
     // -----------
     // Memory Part
     // -----------
 
+    /**
+     * Returns a buffer to the guest in a single call: `data` is copied into
+     * memory obtained from the guest's own `malloc` (exported by wasi-kit
+     * builds), and ownership passes to the guest.
+     * @returns a pointer to the copy, or 0 if the guest does not export an
+     *   allocator (callers then fall back to the `*_get`/`sorry` protocol)
+     */
+    userReturnBuffer(data: Uint8Array): i32 {
+        let malloc = this.instance.exports.malloc;
+        if (!(malloc instanceof Function)) return 0;
+        let ptr = malloc(data.length);
+        if (ptr) this.memView.write(ptr, data);  // `malloc` may have grown memory
+        return ptr;
+    }
+
+    userReturnCStringUTF8(s: string) {
+        return this.userReturnBuffer(this.te.encode(s + '\0'));
+    }
+
+    /** @deprecated old binaries only; new code uses `userReturnBuffer` */
     pending: (() => void)[] = []
 
-    private td = new TextDecoder();
     private te = new TextEncoder();
 
     userGetCString(ptr: i32) {
         if (ptr === 0) return this.te.encode("(null)");
-        let i8a = new Uint8Array(this._mem.buffer);
-        let end = i8a.indexOf(0, ptr);
-        return i8a.slice(ptr, end);
+        return this.memView.getCString(ptr);
     }
 
     userGetCStringUTF8(ptr: i32) {
         return ptr === 0 ? '(null)' : 
-                this.td.decode(this.userGetCString(ptr));
+                this.memView.getCStringUTF8(ptr);
     }
 
     userPendingBuffer(data: Uint8Array, pbuf: i32) {
         this.pending.push(() => {
-            let buf = this.mem.getUint32(pbuf, true);
-            new Uint8Array(this._mem.buffer).set(data, buf);
+            let mv = this.memView;
+            mv.write(mv.dv.getUint32(pbuf, true), data);
         });
         return data.length;
     }
@@ -154,6 +261,7 @@ class Proc {
     /**
      * Flushes pending operations on allocated memory.
      * This is a nasty hack and so deserves an apology.
+     * (Still imported by binaries built before `userReturnBuffer` existed.)
      */
     sorry() {
         for (var f: () => void; f = this.pending.pop(); f());
@@ -173,8 +281,9 @@ class Proc {
 
     stdExceptionWhat(exn: WebAssembly.Exception | i32) {
         let thrown = typeof exn === 'number' ? exn : this.getThrown(exn),
-            vtable = this.mem.getUint32(thrown, true),
-            what = this.mem.getUint32(vtable + 8, true);  /* offset of `what()` in vtable */
+            mem = this.mem,
+            vtable = mem.getUint32(thrown, true),
+            what = mem.getUint32(vtable + 8, true);  /* offset of `what()` in vtable */
         return this.userGetCStringUTF8(this.funcTable.get(what)(thrown));
     }
 }
@@ -183,9 +292,11 @@ class Proc {
 class Longjmp {
     env: i32
     val: i32
-    constructor(env: i32, val: i32) {
+    t0: number  /* for tracing */
+    constructor(env: i32, val: i32, t0 = 0) {
         this.env = env;
         this.val = val;
+        this.t0 = t0;
     }
 }
 
@@ -1,68 +1,469 @@
-import assert from 'assert';
 import { EventEmitter } from 'events';
+import { waitAsync } from './wait-async';
 
 
+/**
+ * Signals sent to a process; kept in shared memory so that any thread can
+ * send, and all threads of the process receive from the same vector (see
+ * `SignalTable`). Layout of `state`:
+ *  - `[SEQ]` bumped on every send (the word that waiters park on);
+ *  - `[PENDING]`, `[PENDING_HI]` bitmask of pending signals, bit `signum - 1`
+ *    (signals 1-32, 33-64);
+ *  - `[GEN]` bumped whenever the vector (a slot of a `SignalTable`) changes
+ *    hands; a handle only sends while it is `live`, i.e. to the process it
+ *    was made for;
+ *  - `[RAISED]`, `[RAISED_HI]` like `[PENDING]`, but only cleared by the
+ *    observer (`observe`), so that it sees signals taken before it woke up;
+ *  - `[VALUES + signum]` payload of a pending standard signal.
+ * Checking for pending signals is a single atomic load (two, for real-time
+ * signals).
+ *
+ * Standard signals coalesce: sends that happen before delivery count as one
+ * (with the payload of the latest). Real-time signals (`SIGRTMIN`..`SIGRTMAX`)
+ * are queued with a payload in a `SignalQueue`, a lock-free ring per signal;
+ * instances of one signal are delivered in the order sent, to whichever
+ * thread takes them, and lower-numbered signals first.
+ *
+ * Signal masks are passed as two 32-bit words, `mask` and `maskHi`.
+ */
 class SignalVector extends EventEmitter {
 
-    wait: Int32Array;
-    _snapshot?: Int32Array;
+    state: Int32Array;
+    queued: SignalQueue;
+    gen: number;
     handlers: sighandler[];
+    handled = 0;    /* bitmask of signals that have a handler */
+    handledHi = 0;
 
-    debug: (...args: any) => void
+    value = 0;      /* payload of the signal last returned by `take` */
+
+    debug: (...args: any) => void = () => {}
 
     constructor(_from: SignalVectorProps={}) {
         super();
-        this.wait = _from.wait || new Int32Array(new MaybeSharedArrayBuffer(4 * NSIG));
+        this.state = _from.state || new Int32Array(new MaybeSharedArrayBuffer(4 * STATE_SIZE));
+        this.queued = new SignalQueue(_from.queue);
+        this.gen = _from.gen ?? Atomics.load(this.state, GEN);
         this.handlers = Array(NSIG);
     }
 
     static from(props: SignalVectorProps) { return new SignalVector(props); }
 
     to(): SignalVectorProps {
-        return {wait: this.wait};
+        return {state: this.state, queue: this.queued.buf, gen: this.gen};
+    }
+
+    /** Whether the vector still belongs to the process this handle was made for. */
+    get live() {
+        return Atomics.load(this.state, GEN) === this.gen;
     }
 
+    /**
+     * Sends a signal; real-time signals are queued (with a payload of 0).
+     * @returns `false` if `signum` is out of range, the queue is full, or the
+     *   process is gone
+     */
     send(signum: number) {
-        assert(0 < signum && signum < NSIG);
-        Atomics.add(this.wait, 0, 1);
-        Atomics.add(this.wait, signum, 1);
-        Atomics.notify(this.wait, 0, 1);
+        return this.queue(signum, 0);
+    }
+
+    /**
+     * Sends a signal with a payload (`sigqueue`). Real-time signals are
+     * queued; a standard signal that is already pending keeps one instance,
+     * with this payload.
+     * Lock-free, so the main thread can call it too.
+     * @returns `false` if `signum` is out of range, its queue is full (`EAGAIN`),
+     *   or the process is gone
+     */
+    queue(signum: number, value: number) {
+        if (!(0 < signum && signum < NSIG) || !this.live) return false;
+        if (signum >= SIGRTMIN) {
+            if (!this.queued.push(signum, value)) return false;
+        }
+        else
+            Atomics.store(this.state, VALUES + signum, value);
+        this._pend(signum);
+        this._notify();
+        return true;
+    }
+
+    /** Bitmask of pending signals 1-32 (bit `signum - 1`). */
+    get pending() {
+        return Atomics.load(this.state, PENDING);
+    }
+
+    /** Bitmask of pending signals 33-64. */
+    get pendingHi() {
+        return Atomics.load(this.state, PENDING_HI);
+    }
+
+    handle(signum: number, h?: sighandler) {
+        this.handlers[signum] = h;
+        if (signum > 32)
+            this.handledHi = h ? this.handledHi | sigbit(signum) : this.handledHi & ~sigbit(signum);
+        else
+            this.handled = h ? this.handled | sigbit(signum) : this.handled & ~sigbit(signum);
     }
 
+    /**
+     * Dispatches pending signals that have handlers, in order of signal
+     * number; instances of a queued signal in the order sent.
+     * Signals without a handler are left pending.
+     * @param signums restricts delivery to these signals
+     * @returns number of signals delivered
+     */
     receive(signums?: number[]) {
-        if (!this._snapshot) this._snapshot = new Int32Array(NSIG);
+        let mask = this.handled, maskHi = this.handledHi;
+        if (signums) { mask &= sigmask(signums, 0); maskHi &= sigmask(signums, 32); }
 
-        //Atomics.wait(this.wait, 0, Atomics.load(this.wait, 0));
+        let n = 0;
+        for (let signum: number; signum = this.take(mask, maskHi); n++)
+            this.dispatch(signum, this.value);
+        return n;
+    }
 
-        this.sweep(signums);
-        return -1;
+    /**
+     * Takes (un-pends) a pending signal in the mask: the lowest-numbered one,
+     * and of a queued signal, the instance sent first. Its payload goes to `value`.
+     * @returns its number, or 0 if none is pending
+     */
+    take(mask: number, maskHi = 0) {
+        let bits: number, bitsHi: number;
+        while ((bits = this.pending & mask) | (bitsHi = this.pendingHi & maskHi)) {
+            let signum = bits ? lowest(bits) : 32 + lowest(bitsHi);
+            if (signum >= SIGRTMIN) {
+                if (this._takeQueued(signum)) return signum;
+            }
+            /* unless another thread took it meanwhile */
+            else if (this._unpend(signum)) {
+                this.value = Atomics.load(this.state, VALUES + signum);
+                return signum;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * Blocks the calling thread until a signal in the mask is pending, and takes
+     * it (`sigwait`/`sigtimedwait`). Parks on `Atomics.wait`; no spinning.
+     * Not allowed on the main thread, see `waitAsync`.
+     * @param timeout in milliseconds
+     * @returns the signal number, or 0 on timeout
+     */
+    wait(mask: number, timeout = Infinity, maskHi = 0) {
+        let deadline = performance.now() + timeout;
+        while (true) {
+            let seq = Atomics.load(this.state, SEQ),
+                signum = this.take(mask, maskHi);
+            if (signum) return signum;
+            let left = deadline - performance.now();
+            if (left <= 0) return 0;
+            Atomics.wait(this.state, SEQ, seq, left);
+        }
+    }
+
+    /** Like `wait`, but does not block; for the main thread. */
+    async waitAsync(mask: number, timeout = Infinity, maskHi = 0) {
+        let deadline = performance.now() + timeout;
+        while (true) {
+            let seq = Atomics.load(this.state, SEQ),
+                signum = this.take(mask, maskHi);
+            if (signum) return signum;
+            let left = deadline - performance.now();
+            if (left <= 0) return 0;
+            await this._park(seq, left);
+        }
+    }
+
+    /**
+     * Watches for signals in the mask without blocking, for the main thread;
+     * emits `'signal'` (with the signal number) for each that was sent since
+     * it last looked, even if the process has taken it already. There is one
+     * such observer per vector (it clears `[RAISED]`).
+     * Ends by itself once the vector is no longer `live`.
+     * @param take also takes the signals, and calls their handlers (if any),
+     *   with the payload emitted too; otherwise they are left to the process
+     * @returns a function that stops observing
+     */
+    observe(mask = ~0, maskHi = ~0, take = false) {
+        let active = true;
+        (async () => {
+            while (active && this.live) {
+                let seq = Atomics.load(this.state, SEQ);
+                if (take) {
+                    let signum = this.take(mask, maskHi);
+                    if (signum) {
+                        this.dispatch(signum, this.value);
+                        this.emit('signal', signum, this.value);
+                        continue;
+                    }
+                }
+                else {
+                    let bits = Atomics.exchange(this.state, RAISED, 0) & mask,
+                        bitsHi = Atomics.exchange(this.state, RAISED_HI, 0) & maskHi;
+                    for (let b = bits; b; b &= b - 1) this.emit('signal', lowest(b));
+                    for (let b = bitsHi; b; b &= b - 1) this.emit('signal', 32 + lowest(b));
+                }
+                await this._park(seq);
+            }
+        })();
+        return () => {
+            active = false;
+            this._notify();
+        };
+    }
+
+    dispatch(signum: number, value = 0) {
+        let h = this.handlers[signum];
+        this.debug('calling', h);
+        h?.(signum, value);
+    }
+
+    /** Resolves once `[SEQ]` moves past `seq` (or on timeout). */
+    _park(seq: number, timeout = Infinity) {
+        return waitAsync(this.state, SEQ, seq, timeout);
+    }
+
+    _notify() {
+        Atomics.add(this.state, SEQ, 1);
+        Atomics.notify(this.state, SEQ);
+    }
+
+    _pend(signum: number) {
+        Atomics.or(this.state, sigword(signum), sigbit(signum));
+        Atomics.or(this.state, sigword(signum) + RAISED - PENDING, sigbit(signum));
+    }
+
+    /** @returns whether the signal was pending */
+    _unpend(signum: number) {
+        return (Atomics.and(this.state, sigword(signum), ~sigbit(signum)) & sigbit(signum)) !== 0;
+    }
+
+    /**
+     * Takes the first queued instance of real-time signal `signum`, if any.
+     * The pending bit goes once its queue is empty; senders push first and
+     * set the bit after, so it is set again if one got in meanwhile.
+     */
+    _takeQueued(signum: number) {
+        let q = this.queued, took = q.shift(signum);
+        if (took) this.value = q.value;
+        if (q.empty(signum)) {
+            this._unpend(signum);
+            if (!q.empty(signum)) this._pend(signum);
+        }
+        return took;
+    }
+
+}
+
+
+/**
+ * Queued real-time signals of a process, in shared memory: a bounded ring
+ * of payloads per signal, which any thread may push to or shift from without
+ * locks (each cell has a sequence number that says whose turn it is).
+ * Layout, per signal from `SIGRTMIN` on: `[HEAD, TAIL]`, then `capacity`
+ * cells of `[seq, value]`.
+ */
+class SignalQueue {
+    buf: Int32Array
+    capacity: number
+
+    value = 0;      /* payload of the entry last shifted */
+
+    constructor(buf?: Int32Array) {
+        this.buf = buf ?? new Int32Array(new MaybeSharedArrayBuffer(4 * QUEUE_SIZE));
+        this.capacity = (this.buf.length / NQUEUED - QUEUE_HEADER) / QUEUE_ENTRY;
+        if (!buf) this.clear();
+    }
+
+    /** @returns `false` if the signal's queue is full */
+    push(signum: number, value: number) {
+        let b = this.buf, at = this._ring(signum), mask = this.capacity - 1,
+            pos = Atomics.load(b, at + QUEUE_TAIL);
+        while (true) {
+            let cell = at + QUEUE_HEADER + QUEUE_ENTRY * (pos & mask),
+                dif = (Atomics.load(b, cell) - pos) | 0;
+            if (dif === 0) {
+                let cur = Atomics.compareExchange(b, at + QUEUE_TAIL, pos, (pos + 1) | 0);
+                if (cur === pos) {
+                    b[cell + 1] = value;
+                    Atomics.store(b, cell, (pos + 1) | 0);
+                    return true;
+                }
+                pos = cur;
+            }
+            else if (dif < 0) return false;
+            else pos = Atomics.load(b, at + QUEUE_TAIL);
+        }
     }
 
-    sweep(signums?: number[]) {
-        for (let i = 1; i < NSIG; i++) {
-            if (!signums || signums.includes(i)) {
-                let h = this.handlers[i];
-                if (h && this._snapshot[i] < this.wait[i]) {
-                    this.debug('calling', h);
-                    h(i);
-                } 
-                this._snapshot[i] = this.wait[i];
+    /** Takes the signal's first entry, if any, into `value`. */
+    shift(signum: number) {
+        let b = this.buf, at = this._ring(signum), mask = this.capacity - 1,
+            pos = Atomics.load(b, at + QUEUE_HEAD);
+        while (true) {
+            let cell = at + QUEUE_HEADER + QUEUE_ENTRY * (pos & mask),
+                dif = (Atomics.load(b, cell) - ((pos + 1) | 0)) | 0;
+            if (dif === 0) {
+                let cur = Atomics.compareExchange(b, at + QUEUE_HEAD, pos, (pos + 1) | 0);
+                if (cur === pos) {
+                    this.value = b[cell + 1];
+                    Atomics.store(b, cell, (pos + mask + 1) | 0);
+                    return true;
+                }
+                pos = cur;
             }
+            else if (dif < 0) return false;
+            else pos = Atomics.load(b, at + QUEUE_HEAD);
+        }
+    }
+
+    empty(signum: number) {
+        let at = this._ring(signum);
+        return Atomics.load(this.buf, at + QUEUE_HEAD) === Atomics.load(this.buf, at + QUEUE_TAIL);
+    }
+
+    /** Only while no other thread uses the queue (i.e. in `SignalTable.allocate`). */
+    clear() {
+        let b = this.buf;
+        for (let signum = SIGRTMIN; signum <= SIGRTMAX; signum++) {
+            let at = this._ring(signum);
+            Atomics.store(b, at + QUEUE_HEAD, 0);
+            Atomics.store(b, at + QUEUE_TAIL, 0);
+            for (let k = 0; k < this.capacity; k++)
+                Atomics.store(b, at + QUEUE_HEADER + QUEUE_ENTRY * k, k);
         }
     }
 
+    _ring(signum: number) {
+        return (signum - SIGRTMIN) * (QUEUE_HEADER + QUEUE_ENTRY * this.capacity);
+    }
+}
+
+
+/**
+ * The signal vectors of all processes, in one block of shared memory that
+ * every worker has (`shared`), so that any of them can get at a process'
+ * vector from its slot number. The init process takes a slot per spawn and
+ * puts it in the process' environment (`SIGVEC_ENV`), from where each of the
+ * process' threads joins it (`sigattach` in `include/signal.h`); the host gets
+ * the vector with the spawn reply. A slot is released when the process exits,
+ * which makes handles to it dead (see `SignalVector.live`).
+ * Layout: `used` has a word per slot (0 free, 1 taken); `vectors` has the
+ * `state` and queue of each slot, back to back.
+ */
+class SignalTable {
+    used: Int32Array
+    vectors: Int32Array
+
+    static shared: SignalTable
+
+    constructor(props?: SignalTableProps, capacity = TABLE_CAPACITY) {
+        this.used = props?.used ?? new Int32Array(new MaybeSharedArrayBuffer(4 * capacity));
+        this.vectors = props?.vectors ??
+            new Int32Array(new MaybeSharedArrayBuffer(4 * capacity * VECTOR_SIZE));
+    }
+
+    static from(props: SignalTableProps) { return new SignalTable(props); }
+
+    to(): SignalTableProps {
+        return {used: this.used, vectors: this.vectors};
+    }
+
+    get capacity() { return this.used.length; }
+
+    /** @returns a fresh slot, or -1 if all are taken */
+    allocate() {
+        for (let slot = 0; slot < this.capacity; slot++)
+            if (Atomics.compareExchange(this.used, slot, 0, 1) === 0) {
+                let at = slot * VECTOR_SIZE;
+                Atomics.store(this.vectors, at + PENDING, 0);
+                Atomics.store(this.vectors, at + PENDING_HI, 0);
+                Atomics.store(this.vectors, at + RAISED, 0);
+                Atomics.store(this.vectors, at + RAISED_HI, 0);
+                this.vector(slot).queued.clear();
+                Atomics.add(this.vectors, at + GEN, 1);
+                return slot;
+            }
+        return -1;
+    }
+
+    /** Handles to the slot go dead right away (and their observers end). */
+    release(slot: number) {
+        let at = slot * VECTOR_SIZE;
+        Atomics.add(this.vectors, at + GEN, 1);
+        Atomics.add(this.vectors, at + SEQ, 1);
+        Atomics.notify(this.vectors, at + SEQ);
+        Atomics.store(this.used, slot, 0);
+    }
+
+    vector(slot: number) {
+        let at = slot * VECTOR_SIZE;
+        return new SignalVector({
+            state: this.vectors.subarray(at, at + STATE_SIZE),
+            queue: this.vectors.subarray(at + STATE_SIZE, at + VECTOR_SIZE)
+        });
+    }
 }
 
+
 type SignalVectorProps = {
-    wait?: Int32Array
+    state?: Int32Array
+    queue?: Int32Array
+    gen?: number        /* the generation that the handle belongs to */
 };
 
-type sighandler = (signum: number) => void;
+type SignalTableProps = {used: Int32Array, vectors: Int32Array};
+
+type sighandler = (signum: number, value?: number) => void;
+
+const NSIG = 65,
+      SIGRTMIN = 34,
+      SIGRTMAX = 64;
 
-const NSIG = 20;
+const SEQ = 0,
+      PENDING = 1,
+      PENDING_HI = 2,
+      GEN = 3,
+      RAISED = 4,
+      RAISED_HI = 5,
+      VALUES = 6,
+      STATE_SIZE = VALUES + SIGRTMIN;
+
+const QUEUE_HEAD = 0,
+      QUEUE_TAIL = 1,
+      QUEUE_HEADER = 2,
+      QUEUE_ENTRY = 2,
+      QUEUE_CAPACITY = 64,   /* per signal; a power of 2 */
+      NQUEUED = SIGRTMAX - SIGRTMIN + 1,
+      QUEUE_SIZE = NQUEUED * (QUEUE_HEADER + QUEUE_ENTRY * QUEUE_CAPACITY);
+
+const VECTOR_SIZE = STATE_SIZE + QUEUE_SIZE,
+      TABLE_CAPACITY = 128;
+
+/** environment variable that tells a process its slot in `SignalTable.shared` */
+const SIGVEC_ENV = 'WASIK_SIGVEC';
+
+function sigword(signum: number) {
+    return signum > 32 ? PENDING_HI : PENDING;
+}
+
+function sigbit(signum: number) {
+    return 1 << ((signum - 1) & 31);
+}
+
+/** bits of the signals in `signums` that fall in the word starting after `base` */
+function sigmask(signums: number[], base: number) {
+    return signums.reduce((m, i) => (i > base && i <= base + 32) ? m | sigbit(i) : m, 0);
+}
+
+function lowest(bits: number) {
+    return 32 - Math.clz32(bits & -bits);
+}
 
 const MaybeSharedArrayBuffer = typeof SharedArrayBuffer != 'undefined'
     ? SharedArrayBuffer : ArrayBuffer;
 
 
-export { SignalVector }
\ No newline at end of file
+export { SignalVector, SignalVectorProps, SignalQueue, SignalTable, SignalTableProps,
+         SIGVEC_ENV, NSIG, SIGRTMIN, SIGRTMAX }
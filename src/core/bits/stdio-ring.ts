@@ -0,0 +1,172 @@
+import { waitAsync } from './wait-async';
+
+/**
+ * Single-producer/single-consumer byte ring in shared memory, used to carry
+ * a process' output to the main thread without a message per chunk.
+ *
+ * Header (`Int32Array`): `[HEAD]` bytes written so far, `[TAIL]` bytes read
+ * so far (both wrap around), `[CLOSED]` set by the producer at end of stream.
+ * The producer rings a doorbell (shared by all rings of a process) after
+ * every write, so that a reader can wait on several rings at once;
+ * the consumer notifies `[TAIL]`, on which a producer with a full ring waits.
+ */
+class ByteRing {
+    hdr: Int32Array
+    data: Uint8Array
+    bell: Int32Array
+    capacity: number    /* a power of 2 */
+
+    constructor(props: ByteRingProps) {
+        this.hdr = props.hdr;
+        this.data = props.data;
+        this.bell = props.bell;
+        this.capacity = this.data.length;
+    }
+
+    static create(bell: Int32Array, capacity = DEFAULT_CAPACITY) {
+        return new ByteRing({
+            hdr: new Int32Array(new SharedArrayBuffer(4 * HEADER_SIZE)),
+            data: new Uint8Array(new SharedArrayBuffer(capacity)),
+            bell
+        });
+    }
+
+    to(): ByteRingProps {
+        return {hdr: this.hdr, data: this.data, bell: this.bell};
+    }
+
+    get closed() {
+        return Atomics.load(this.hdr, CLOSED) !== 0;
+    }
+
+    // - producer side -
+
+    /** @returns the number of bytes that fit */
+    write(bytes: Uint8Array) {
+        let head = Atomics.load(this.hdr, HEAD),
+            tail = Atomics.load(this.hdr, TAIL),
+            n = Math.min(this.capacity - ((head - tail) | 0), bytes.length);
+        if (n <= 0) return 0;
+
+        let at = head & (this.capacity - 1),
+            first = Math.min(n, this.capacity - at);
+        this.data.set(bytes.subarray(0, first), at);
+        if (n > first) this.data.set(bytes.subarray(first, n), 0);
+        Atomics.store(this.hdr, HEAD, (head + n) | 0);
+        this._ring();
+        return n;
+    }
+
+    /** Writes all of `bytes`, waiting for the consumer whenever the ring is full. */
+    async writeAll(bytes: Uint8Array) {
+        for (let off = 0; off < bytes.length; ) {
+            let tail = Atomics.load(this.hdr, TAIL),
+                n = this.write(bytes.subarray(off));
+            off += n;
+            if (n === 0) await waitAsync(this.hdr, TAIL, tail);
+        }
+    }
+
+    close() {
+        Atomics.store(this.hdr, CLOSED, 1);
+        this._ring();
+    }
+
+    _ring() {
+        Atomics.add(this.bell, 0, 1);
+        Atomics.notify(this.bell, 0);
+    }
+
+    // - consumer side -
+
+    /** Takes everything there is (as a copy); `undefined` if empty. */
+    read() {
+        let head = Atomics.load(this.hdr, HEAD),
+            tail = Atomics.load(this.hdr, TAIL),
+            n = (head - tail) | 0;
+        if (n === 0) return undefined;
+
+        let at = tail & (this.capacity - 1),
+            first = Math.min(n, this.capacity - at),
+            out = new Uint8Array(n);
+        out.set(this.data.subarray(at, at + first));
+        if (n > first) out.set(this.data.subarray(0, n - first), first);
+        Atomics.store(this.hdr, TAIL, (tail + n) | 0);
+        Atomics.notify(this.hdr, TAIL);
+        return out;
+    }
+}
+
+
+/**
+ * A process' stdout and stderr as a pair of `ByteRing`s sharing a doorbell.
+ */
+class StdioChannel {
+    bell: Int32Array
+    out: ByteRing
+    err: ByteRing
+
+    constructor(props: StdioChannelProps) {
+        this.bell = props.bell;
+        this.out = new ByteRing(props.out);
+        this.err = new ByteRing(props.err);
+    }
+
+    static create(capacity = DEFAULT_CAPACITY) {
+        let bell = new Int32Array(new SharedArrayBuffer(4));
+        return new StdioChannel({
+            bell, out: ByteRing.create(bell, capacity).to(), err: ByteRing.create(bell, capacity).to()
+        });
+    }
+
+    to(): StdioChannelProps {
+        return {bell: this.bell, out: this.out.to(), err: this.err.to()};
+    }
+
+    /**
+     * Waits for output, then returns all that is available on both streams.
+     * @returns `undefined` once both streams are closed and drained
+     */
+    async readBatch(): Promise<StdioBatch | undefined> {
+        while (true) {
+            let seq = Atomics.load(this.bell, 0),
+                out = this.out.read(), err = this.err.read();
+            if (out || err) return {out, err};
+            if (this.out.closed && this.err.closed) {
+                /* (closed after the last write; read again in case it came in between) */
+                out = this.out.read(); err = this.err.read();
+                return out || err ? {out, err} : undefined;
+            }
+            await waitAsync(this.bell, 0, seq);
+        }
+    }
+}
+
+
+/** Pumps a stream into a ring; closes the ring at the end. */
+async function pumpInto(stream: ReadableStream<Uint8Array> | undefined, ring: ByteRing) {
+    try {
+        if (!stream) return;
+        let reader = stream.getReader();
+        for (let r: ReadableStreamReadResult<Uint8Array>; !(r = await reader.read()).done; )
+            await ring.writeAll(r.value);
+    }
+    finally {
+        ring.close();
+    }
+}
+
+
+type ByteRingProps = {hdr: Int32Array, data: Uint8Array, bell: Int32Array};
+type StdioChannelProps = {bell: Int32Array, out: ByteRingProps, err: ByteRingProps};
+type StdioBatch = {out?: Uint8Array, err?: Uint8Array};
+
+const HEAD = 0,
+      TAIL = 1,
+      CLOSED = 2,
+      HEADER_SIZE = 3;
+
+const DEFAULT_CAPACITY = 1 << 20;
+
+
+export { ByteRing, StdioChannel, StdioChannelProps, StdioBatch, pumpInto }
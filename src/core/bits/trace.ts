@@ -0,0 +1,162 @@
+/**
+ * Low-overhead structured tracing.
+ * Every worker (and the main thread) has its own `Tracer`, which records
+ * fixed-size binary events into a ring buffer. When tracing is off, a
+ * call site costs one property read (`begin` returns 0 and `end` bails).
+ *
+ * Rings are allocated in shared memory and announced on a `BroadcastChannel`,
+ * so that a `TraceCollector` (see `services/trace.ts`) can read all of them
+ * without any cooperation from workers that are busy running guest code.
+ */
+
+enum TraceEvent {
+    SPAWN = 1,          // main thread: spawn request until pipes are returned
+    SPAWN_WORKER,       // init worker: compile + instantiate
+    FS_HOOK_WAIT,       // worker: blocked on a filesystem hook;  a0 = op
+    FS_HOOK_RUN,        // main thread: running a hook action;  a0 = op
+    DLOPEN,             // a0 = handle
+    DLSYM,              // a0 = handle, a1 = table index
+    LONGJMP,            // `__control_longjmp` until caught;  a0 = env, a1 = val
+    SIGWAIT             // guest blocked in `sigtimedwait` & co.;  a0 = mask, a1 = signal
+}
+
+const TRACE_EVENT_NAMES: {[ev: number]: string} = {
+    [TraceEvent.SPAWN]: 'spawn',
+    [TraceEvent.SPAWN_WORKER]: 'spawn (worker)',
+    [TraceEvent.FS_HOOK_WAIT]: 'fs-hook wait',
+    [TraceEvent.FS_HOOK_RUN]: 'fs-hook run',
+    [TraceEvent.DLOPEN]: 'dlopen',
+    [TraceEvent.DLSYM]: 'dlsym',
+    [TraceEvent.LONGJMP]: 'longjmp',
+    [TraceEvent.SIGWAIT]: 'sigwait'
+};
+
+
+/**
+ * Ring layout: a header of `HEADER_SIZE` bytes (`i32` cursor = total number
+ * of events ever written), followed by `capacity` records of `EVENT_SIZE`:
+ *
+ *   f64 ts (µs since epoch) | f64 dur (µs; 0 = instant) | i32 event | i32 a0 | i32 a1 | i32 -
+ */
+class TraceRing {
+    buffer: ArrayBufferLike
+    capacity: number
+    cursor: Int32Array
+    f64: Float64Array
+    i32: Int32Array
+
+    static HEADER_SIZE = 32
+    static EVENT_SIZE = 32
+
+    constructor(buffer: ArrayBufferLike) {
+        this.buffer = buffer;
+        this.capacity = (buffer.byteLength - TraceRing.HEADER_SIZE) / TraceRing.EVENT_SIZE;
+        this.cursor = new Int32Array(buffer, 0, 1);
+        this.f64 = new Float64Array(buffer, TraceRing.HEADER_SIZE);
+        this.i32 = new Int32Array(buffer, TraceRing.HEADER_SIZE);
+    }
+
+    static alloc(capacity: number) {
+        return new TraceRing(new MaybeSharedArrayBuffer(
+            TraceRing.HEADER_SIZE + capacity * TraceRing.EVENT_SIZE));
+    }
+
+    push(ts: number, dur: number, ev: TraceEvent, a0: number, a1: number) {
+        let n = this.cursor[0], slot = n % this.capacity,
+            f = slot * (TraceRing.EVENT_SIZE >> 3), i = slot * (TraceRing.EVENT_SIZE >> 2);
+        this.f64[f] = ts;
+        this.f64[f + 1] = dur;
+        this.i32[i + 4] = ev;
+        this.i32[i + 5] = a0;
+        this.i32[i + 6] = a1;
+        Atomics.store(this.cursor, 0, n + 1);  // publish
+    }
+
+    /** Oldest to newest; events overwritten by wrap-around are lost. */
+    *events() {
+        let n = Atomics.load(this.cursor, 0),
+            from = Math.max(0, n - this.capacity);
+        for (let k = from; k < n; k++) {
+            let slot = k % this.capacity,
+                f = slot * (TraceRing.EVENT_SIZE >> 3), i = slot * (TraceRing.EVENT_SIZE >> 2);
+            yield {ts: this.f64[f], dur: this.f64[f + 1], ev: this.i32[i + 4] as TraceEvent,
+                   a0: this.i32[i + 5], a1: this.i32[i + 6]};
+        }
+    }
+}
+
+
+class Tracer {
+    enabled = false
+    ring?: TraceRing
+    name: string
+
+    chan?: BroadcastChannel
+
+    constructor(name: string = globalThis.name || 'main') {
+        this.name = name;
+    }
+
+    /** @returns a start timestamp, or 0 if tracing is off */
+    begin() {
+        return this.enabled ? now() : 0;
+    }
+
+    /** Records a complete event that started at `t0` (no-op if `t0` is 0). */
+    end(ev: TraceEvent, t0: number, a0 = 0, a1 = 0) {
+        if (t0) this.ring.push(t0, now() - t0, ev, a0, a1);
+    }
+
+    instant(ev: TraceEvent, a0 = 0, a1 = 0) {
+        if (this.enabled) this.ring.push(now(), 0, ev, a0, a1);
+    }
+
+    enable(capacity = DEFAULT_CAPACITY) {
+        if (!this.ring || this.ring.capacity !== capacity) {
+            this.ring = TraceRing.alloc(capacity);
+            this.announce();
+        }
+        this.enabled = true;
+    }
+
+    disable() {
+        this.enabled = false;
+    }
+
+    announce() {
+        this.chan?.postMessage({type: 'ring', name: this.name, buffer: this.ring.buffer});
+    }
+
+    /**
+     * Start listening to enable/disable requests from a collector.
+     * Called once per worker (and by the collector, for the main thread).
+     */
+    listen() {
+        if (this.chan || typeof BroadcastChannel === 'undefined') return this;
+        this.chan = new BroadcastChannel(TRACE_CHANNEL);
+        this.chan.addEventListener('message', ({data}) => {
+            switch (data.type) {
+            case 'enable': this.enable(data.capacity); break;
+            case 'disable': this.disable(); break;
+            }
+        });
+        this.chan.postMessage({type: 'hello', name: this.name});
+        return this;
+    }
+
+    static local = new Tracer
+}
+
+
+function now() {
+    return (performance.timeOrigin + performance.now()) * 1000;
+}
+
+const TRACE_CHANNEL = 'wasik-trace',
+      DEFAULT_CAPACITY = 1 << 16;
+
+const MaybeSharedArrayBuffer = typeof SharedArrayBuffer != 'undefined'
+    ? SharedArrayBuffer : ArrayBuffer;
+
+
+export { Tracer, TraceRing, TraceEvent, TRACE_EVENT_NAMES, TRACE_CHANNEL }
@@ -0,0 +1,20 @@
+/**
+ * Parks the calling (main) thread until `arr[index]` is no longer `value`,
+ * without blocking it: `Atomics.waitAsync` where the engine has it, and a
+ * short timer otherwise (so callers re-check their condition in a loop).
+ * @param timeout in milliseconds
+ */
+async function waitAsync(arr: Int32Array, index: number, value: number, timeout = Infinity) {
+    if (typeof Atomics.waitAsync === 'function') {
+        let w = Atomics.waitAsync(arr, index, value, timeout);
+        if (w.async) await w.value;
+    }
+    else  /* no `waitAsync` in this engine */
+        await new Promise(resolve => setTimeout(resolve, Math.min(timeout, POLL_FALLBACK_MS)));
+}
+
+
+const POLL_FALLBACK_MS = 10;
+
+
+export { waitAsync }
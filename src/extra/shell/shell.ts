@@ -10,12 +10,13 @@ import { EventEmitter } from 'events';
 import { Process, Volume, SharedVolume } from '../../kernel';
 import { WorkerPool, ProcessLoader, WorkerPoolItem, SpawnArgs } 
        from '../../kernel/services';
+import { SignalVector } from '../../core/bits/signals';
 
 
 
 class Shell extends EventEmitter implements ProcessLoader {
 
-    fgProcesses: Process[]
+    fgProcesses: (Process & {signals?: SignalVector})[]
     pool: WorkerPool
     env: {[name: string]: string}
     files = new Map<string, string>()
@@ -63,7 +64,7 @@ class Shell extends EventEmitter implements ProcessLoader {
                 /** @oops this only allows a linear process stack */
                 if (this.fgProcesses[0] === p.process) {
                     this.fgProcesses.shift();
-                    this.fgProcesses[0]?.sigvec.send(17 /*SIGCHLD*/)
+                    this.fgProcesses[0]?.signals?.send(17 /*SIGCHLD*/);
                 }
             });
 
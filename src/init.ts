@@ -17,7 +17,6 @@ function initHook(imp: {env?: object, wasik?: object}, m: WebAssembly.Module) {
 
     let proc = new Proc;
     proc._imports = imp;
-    proc.trace.syscalls = console.warn;
     //proc.dyld.trace = console.warn;
 
     // Polyfill stubs
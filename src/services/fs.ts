@@ -1,37 +1,84 @@
+import { Tracer, TraceEvent } from '../core/bits/trace';
+import { FsHookChannel, FsHookChannelProps } from '../core/bits/fs-hook-channel';
 
+
+/**
+ * Runs filesystem hook actions on the main thread, on behalf of workers.
+ * Each worker sets up an `FsHookChannel` on its first hook and registers it
+ * here (with a message that is forwarded up the chain of workers); requests
+ * are then served straight from shared memory, until the worker is
+ * terminated and its parent closes the channel.
+ *
+ * An action runs once, however many requests come for it: requests that
+ * come while it runs wait for the same run, and are all answered when it is
+ * done; requests that come after it is done are answered right away.
+ * An action that failed runs again on the next request.
+ * Requests for different actions are served in parallel.
+ */
 class FsHookMaster {
-    actions = new Map<number, () => Promise<void>>()
+    hooks = new Map<number, FsHook>()
     hid = 0
+    channels: {channel: FsHookChannel, stop: () => void}[] = []
+    stats = {requests: 0, runs: 0, shared: 0, failures: 0, waitMs: 0, maxWaitMs: 0}
 
-    with(actions: typeof this.actions) {
+    with(actions: Map<number, FsHookAction>) {
         for (let [k, v] of actions.entries())
-            this.actions.set(k, v);
+            this.hooks.set(k, new FsHook(v));
         return this;
     }
     
-    add(action: () => Promise<void>) {
+    add(action: FsHookAction) {
         let k = ++this.hid;
-        this.actions.set(k, action)
+        this.hooks.set(k, new FsHook(action));
         return k;
     }
 
+    state(op: number) {
+        return this.hooks.get(op)?.state;
+    }
+
     dispatch(op: number) {
-        if (this.actions.has(op))
+        if (this.hooks.get(op)?.state === 'pending')
             console.warn(' fs hook dispatch from main thread?');
     }
 
-    async intercept(m: {op: number, out: SharedArrayBuffer}) {
-        console.log('==  fs hook intercept ==', m);
-        if (m.op !== undefined) {
-            let op = this.actions.get(m.op);
-            this.actions.delete(m.op);  // each op is single-shot
-            if (op) await op();
+    async intercept(m: {fsHookChannel?: FsHookChannelProps}) {
+        if (m.fsHookChannel) {
+            let channel = new FsHookChannel(m.fsHookChannel);
+            this.channels.push({channel, stop: channel.serve(op => this.run(op),
+                () => this.channels = this.channels.filter(c => c.channel !== channel))});
+        }
+    }
+
+    async run(op: number) {
+        let hook = this.hooks.get(op);
+        if (!hook) return;
 
-            if (m.out)
-                Atomics.notify(new Int32Array(m.out), 0);
+        let t0 = Tracer.local.begin(), start = performance.now(),
+            fresh = hook.state === 'pending' || hook.state === 'failed';
+        this.stats.requests++;
+        if (fresh) this.stats.runs++;
+        else if (hook.state === 'in-flight') this.stats.shared++;
+        try {
+            return await hook.run();
+        }
+        catch (e) {
+            if (fresh) this.stats.failures++;
+            throw e;
+        }
+        finally {
+            let ms = performance.now() - start;
+            hook.waitMs += ms;
+            this.stats.waitMs += ms;
+            this.stats.maxWaitMs = Math.max(this.stats.maxWaitMs, ms);
+            Tracer.local.end(TraceEvent.FS_HOOK_RUN, t0, op);
         }
     }
 
+    stop() {
+        for (let {stop} of this.channels.splice(0)) stop();
+    }
+
     static current() {
         let hook = Reflect.get(window, 'fs_hook');
         return (hook instanceof FsHookMaster) ? hook : undefined;
@@ -39,4 +86,31 @@ class FsHookMaster {
 }
 
 
-export { FsHookMaster }
\ No newline at end of file
+/** An action, and how far it got; `promise` is that of the latest run. */
+class FsHook {
+    action: FsHookAction
+    state: 'pending' | 'in-flight' | 'done' | 'failed' = 'pending'
+    promise?: Promise<void>
+    error?: any
+    waitMs = 0      /* spent by requests waiting on this hook, in total */
+
+    constructor(action: FsHookAction) {
+        this.action = action;
+    }
+
+    /** Starts the action, unless it is running or done already. */
+    run() {
+        if (this.state === 'pending' || this.state === 'failed') {
+            this.state = 'in-flight';
+            this.promise = Promise.resolve().then(() => this.action()).then(
+                out => { this.state = 'done'; this.error = undefined; return out; },
+                e => { this.state = 'failed'; this.error = e; throw e; });
+        }
+        return this.promise;
+    }
+}
+
+type FsHookAction = () => Promise<void>;
+
+
+export { FsHookMaster, FsHook, FsHookAction }
\ No newline at end of file
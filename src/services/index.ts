@@ -2,4 +2,6 @@ export * from './fs'
 export * from './pty'
 export * from './init-process'
 export * from './package-mgr'
-export * from './task-mgr'
\ No newline at end of file
+export * from './task-mgr'
+export * from './trace'
+export * from './worker-pool'
\ No newline at end of file
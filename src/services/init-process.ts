@@ -2,6 +2,9 @@ import * as wasmer from "@wasmer/sdk";
 import { WasmerInitInput } from "@wasmer/sdk";
 
 import { FsHookMaster } from '.';
+import { Tracer, TraceEvent } from '../core/bits/trace';
+import { SignalTable } from '../core/bits/signals';
+import type { WorkerPoolOptions } from './worker-pool';
 
 
 /**
@@ -13,30 +16,74 @@ import { FsHookMaster } from '.';
  */
 class InitProcess {
     worker: Worker
+    inflight = 0    /* spawns not answered yet */
 
-    constructor(init: WasmerInitInput, memory?: WebAssembly.Memory) {
+    constructor(init: WasmerInitInput, memory?: WebAssembly.Memory, opts: InitOptions = {}) {
+        let {pool, concurrency} = opts;
+        SignalTable.shared ??= new SignalTable;   /* one for all init processes */
         this.worker = new Worker(init.workerUrl, {name: 'wasik-init'});
-        this.worker.postMessage({type: 'init', ...init, memory});
+        this.worker.postMessage({type: 'init', ...init, memory, pool: pool || undefined, concurrency,
+                                 signals: SignalTable.shared.to()});
         this.worker.addEventListener('message', (ev) =>
             FsHookMaster.current()?.intercept(ev.data));
     }
 
+    /**
+     * @param bin preferably a compiled module, which is shared with the worker
+     *   rather than copied
+     */
     spawn(bin: Uint8Array | WebAssembly.Module, runOpts: any = {}) {
-        let chan = new MessageChannel();
+        let chan = new MessageChannel(),
+            t0 = Tracer.local.begin();
         this.worker.postMessage({
             type: 'spawn',
             mode: 'wasix',
             bin,
             runOpts,
             port: chan.port2
-        }, [chan.port2]);        
+        }, [chan.port2]);
         
-        return new Promise<wasmer.Instance>(resolve => {
-            chan.port1.addEventListener('message', m => resolve(m.data));
+        this.inflight++;
+        return new Promise<wasmer.Instance>((resolve, reject) => {
+            chan.port1.addEventListener('message', m => {
+                this.inflight--;
+                Tracer.local.end(TraceEvent.SPAWN, t0);
+                if (m.data.error) reject(new Error(m.data.error));
+                else resolve(m.data);
+                chan.port1.close();
+            });
             chan.port1.start();
         });
     }
 }
 
 
-export { InitProcess }
\ No newline at end of file
+/**
+ * Several init processes (shards); each spawn goes to the one with the
+ * fewest spawns in flight.
+ */
+class InitProcessGroup {
+    members: InitProcess[]
+
+    constructor(size: number, init: WasmerInitInput, memory?: WebAssembly.Memory,
+                opts: InitOptions = {}) {
+        this.members = Array.from({length: Math.max(size, 1)},
+            () => new InitProcess(init, memory, opts));
+    }
+
+    spawn(...args: Parameters<InitProcess['spawn']>) {
+        let least = this.members.reduce((a, b) => b.inflight < a.inflight ? b : a);
+        return least.spawn(...args);
+    }
+}
+
+
+type InitOptions = {
+    /** the pool of pre-warmed workers for Wasmer's thread pool; off unless given */
+    pool?: Partial<WorkerPoolOptions> | false
+    /** number of spawns that an init process works on at once */
+    concurrency?: number
+};
+
+
+export { InitProcess, InitProcessGroup, InitOptions }
\ No newline at end of file
@@ -8,7 +8,7 @@
 import path from 'path';
 import { EventEmitter } from 'events';
 
-import { unzipSync } from 'fflate';
+import { unzipSync, Unzip, UnzipInflate } from 'fflate';
 import tar from 'tar-stream';
 import concat from 'concat-stream';
 
@@ -33,12 +33,13 @@ import { FsHookMaster } from './fs';
 class PackageManager extends EventEmitter {
 
     volume: Volume
-    opts: {fastInflate: boolean}
+    opts: {fastInflate: boolean, streaming: boolean, memoryCeiling: number}
+    stats = {bytesFetched: 0, filesFetched: 0}   /* by indexed lazy mounts; bytes as transferred */
 
     constructor(volume: Volume) {
         super();
         this.volume = volume;
-        this.opts = {fastInflate: true};
+        this.opts = {fastInflate: true, streaming: true, memoryCeiling: 64 << 20};
     }
 
     async installFile(filename: string, content: string | Uint8Array | Resource) {
@@ -57,8 +58,11 @@ class PackageManager extends EventEmitter {
     }
 
     async installZip(rootdir: string, content: Resource | Blob, progress: (p: DownloadProgress) => void = () => {}) {
+        if (this.opts.streaming)
+            return this._installZipStreaming(rootdir, content, progress);
+
         var payload = (content instanceof Resource) ? await content.blob(progress) : content,
-            ui8a = new Uint8Array(await payload.arrayBuffer());  /** @todo streaming? */
+            ui8a = new Uint8Array(await payload.arrayBuffer());
 
         for (let [filename, content] of Object.entries(unzipSync(ui8a))) {
             let fullpath = path.join(rootdir, filename);
@@ -66,9 +70,107 @@ class PackageManager extends EventEmitter {
         }
     }
 
+    /**
+     * Inflates entries as the archive comes in, and writes each one as soon
+     * as it is complete. Inflated data that is not written yet is kept under
+     * `opts.memoryCeiling`, by holding back the download; only an entry that
+     * is by itself larger than that goes over (a file is written whole).
+     */
+    async _installZipStreaming(rootdir: string, content: Resource | Blob, progress: (p: DownloadProgress) => void) {
+        let source = (content instanceof Resource) ? await content.stream(progress) : content.stream(),
+            unzip = new Unzip(), held = 0, writing = new Set<Promise<void>>(), error: any;
+
+        const write = (p: Promise<void>, size: number) => {
+            let w = p.catch(e => { error ??= e; })
+                     .finally(() => { held -= size; writing.delete(w); });
+            writing.add(w);
+        };
+
+        unzip.register(UnzipInflate);
+        unzip.onfile = file => {
+            let fullpath = path.join(rootdir, file.name);
+            if (file.name.endsWith('/')) {
+                write(this.volume.mkdir(fullpath, {recursive: true}), 0);
+                return;
+            }
+            let chunks: Uint8Array[] = [], size = 0;
+            file.ondata = (err, chunk, final) => {
+                if (err) { error ??= err; return; }
+                chunks.push(chunk);
+                size += chunk.length;
+                held += chunk.length;
+                if (final) write(this._installFile(fullpath, concatChunks(chunks, size)), size);
+            };
+            file.start();
+        };
+
+        let reader = source.getReader();
+        try {
+            for (let r: ReadableStreamReadResult<Uint8Array>; !(r = await reader.read()).done; ) {
+                unzip.push(r.value);
+                while (held > this.opts.memoryCeiling && writing.size > 0)
+                    await Promise.race(writing);
+                if (error) throw error;
+            }
+            unzip.push(new Uint8Array(0), true);
+            await Promise.all(writing);
+            if (error) throw error;
+        }
+        catch (e) {
+            await reader.cancel(e).catch(() => {});
+            throw e;
+        }
+    }
+
+    /**
+     * Extracts a tar, compressed or not, as it comes in: the download is
+     * piped through a decompressor (see `decoders`; the format is told by the
+     * first bytes) into the extractor, which writes files as they complete;
+     * downloading, decompressing and writing overlap. The extractor holds back
+     * the download while it waits for writes.
+     */
     async installTar(rootdir: string, content: Resource | Blob, progress: (p: DownloadProgress) => void = () => {}) {
+        if (!this.opts.streaming)
+            return this._installTarBuffered(rootdir, content, progress);
+
+        let [format, source] = await sniffCompression(
+                (content instanceof Resource) ? await content.stream(progress) : content.stream());
+        if (format) source = source.pipeThrough(PackageManager.decoder(format));
+
+        let extract = this._tarExtract(rootdir),
+            finished = new Promise((resolve, reject) => {
+                extract.on('finish', resolve);
+                extract.on('error', reject);
+            }),
+            reader = source.getReader();
+        try {
+            for (let r: ReadableStreamReadResult<Uint8Array>; !(r = await reader.read()).done; ) {
+                if (!extract.write(r.value))
+                    await Promise.race([new Promise(resolve => extract.once('drain', resolve)), finished]);
+            }
+            extract.end();
+            await finished;
+        }
+        catch (e) {
+            await reader.cancel(e).catch(() => {});
+            extract.destroy(e);
+            throw e;
+        }
+    }
+
+    async _installTarBuffered(rootdir: string, content: Resource | Blob, progress: (p: DownloadProgress) => void) {
         var payload = (content instanceof Resource) ? await content.blob(progress) : content,
-            ui8a = new Uint8Array(await payload.arrayBuffer());  /** @todo streaming? */
+            ui8a = new Uint8Array(await payload.arrayBuffer());
+        let extract = this._tarExtract(rootdir);
+
+        await new Promise((resolve, reject) => {
+            extract.on('finish', resolve);
+            extract.on('error', reject);
+            extract.end(ui8a);
+        });
+    }
+
+    _tarExtract(rootdir: string) {
         let extract = tar.extract();
         extract.on('entry', async (header, stream, next) => {
             let fullpath = path.join(rootdir, header.name), wait = false;
@@ -91,12 +193,7 @@ class PackageManager extends EventEmitter {
             stream.on('end', () => next());
             stream.resume();
         });
-        
-        await new Promise((resolve, reject) => {
-            extract.on('finish', resolve);
-            extract.on('error', reject);
-            extract.end(ui8a);
-        });
+        return extract;
     }
 
     async installArchive(rootdir: string, content: Resource | Resource[], progress: (p: DownloadProgress) => void = () => {}) {
@@ -138,7 +235,8 @@ class PackageManager extends EventEmitter {
                         this.emit('progress', {path: filename, uri: uri ?? p.uri, download: p, done: false}));
                 else if (content instanceof SpecialEntry) {
                     if (content instanceof Lazily)
-                        await this.subinstall(filename, content.bundle);
+                        await (content.index ? this.subinstallIndexed(filename, content.index)
+                                             : this.subinstall(filename, content.bundle));
                     else
                         console.warn(`unexpected entry for directory '${filename}';`, content);
                 }
@@ -162,11 +260,71 @@ class PackageManager extends EventEmitter {
             console.warn(`subinstall skipped for '${dir}' (not a Wasmer volume)`);
     }
 
+    /**
+     * Mounts a bundle from its index; what is fetched is the files that a
+     * program actually opens. Wasmer's hook fires per directory, and does not
+     * tell which entry was looked up; so each file is a stub: a symlink to
+     * `LAZY_DIR/<name>/<name>`, where `LAZY_DIR/<name>` is a volume of its own,
+     * populated with just that file on first access. Directories and stubs
+     * are there from the start, so listing a directory fetches nothing.
+     */
+    async subinstallIndexed(dir: string, index: BundleIndex) {
+        if (this.volume instanceof DirectoryVolumeAdapter)
+            await this.volume.mount(dir, await this._lazyDir(dir, indexTree(index).get(''), index));
+        else
+            console.warn(`subinstall skipped for '${dir}' (not a Wasmer volume)`);
+    }
+
+    async _lazyDir(dir: string, node: IndexNode, index: BundleIndex) {
+        let vol = new DirectoryVolumeAdapter({readonly: true});
+        for (let [name, sub] of node.dirs)
+            await vol.mount(`/${name}`, await this._lazyDir(path.join(dir, name), sub, index));
+        for (let [name, entry] of node.files) {
+            await vol.mount(`/${LAZY_DIR}/${name}`, this._lazyFile(path.join(dir, name), entry, index));
+            await vol.symlink(`${LAZY_DIR}/${name}/${name}`, `/${name}`);
+        }
+        return vol;
+    }
+
+    _lazyFile(filename: string, entry: BundleIndex['files'][string], index: BundleIndex) {
+        let uri = entry.uri ?? index.base?.uri;
+        return new DirectoryVolumeAdapter({readonly: true}).withHook(async v => {
+            this.emit('progress', {path: filename, uri, done: false});
+            let content = await fetchEntry(index, entry, n => this.stats.bytesFetched += n);
+            this.stats.filesFetched++;
+            await v.writeFile(`/${path.basename(filename)}`, content);
+            this.emit('progress', {path: filename, uri, done: true});
+        });
+    }
+
     asBundle(bundle: ResourceBundle | Resource) {
         return Array.isArray(bundle) || bundle instanceof Resource ?
             {"/": bundle} : bundle;
     }
 
+    /**
+     * Decompressors, by format. `gzip` and `deflate` are built in (with
+     * `DecompressionStream`); others, such as `zstd` and `xz`, are registered
+     * here by the embedder -- typically a Wasm decoder wrapped in a
+     * `TransformStream`. Engines whose `DecompressionStream` knows a format
+     * need no registration.
+     */
+    static decoders: {[format: string]: () => ReadableWritablePair<Uint8Array, Uint8Array>} = {
+        gzip: () => new DecompressionStream('gzip') as ReadableWritablePair<Uint8Array, Uint8Array>,
+        deflate: () => new DecompressionStream('deflate') as ReadableWritablePair<Uint8Array, Uint8Array>
+    }
+
+    static decoder(format: string) {
+        let factory = PackageManager.decoders[format];
+        if (factory) return factory();
+        try {
+            return new DecompressionStream(format as CompressionFormat) as ReadableWritablePair<Uint8Array, Uint8Array>;
+        }
+        catch {
+            throw new Error(`no decoder for '${format}' (see PackageManager.decoders)`);
+        }
+    }
+
     /**
      * Create a new `PackageManager` and bind events to the current ones.
      */
@@ -186,9 +344,24 @@ class Symlink extends SpecialEntry {
     constructor(public target: string) { super(); } 
 }
 class Lazily extends SpecialEntry {
-    constructor(public bundle: Resource | ResourceBundle) { super(); }
+    constructor(public bundle: Resource | ResourceBundle, public index?: BundleIndex) { super(); }
+
+    /** A bundle described by a file index; see `PackageManager.subinstallIndexed`. */
+    static indexed(index: BundleIndex) {
+        return new Lazily({}, index);
+    }
 }
 
+/**
+ * Where each file of a bundle is: at `offset` in `base` (e.g. an uncompressed
+ * tar, see `indexTar`), or at a URI of its own.
+ * Paths are relative to the bundle root, `/`-separated; directories are implied.
+ */
+type BundleIndex = {
+    base?: Resource
+    files: {[path: string]: {size: number, offset?: number, uri?: string}}
+};
+
 function isMultiple(x: any): x is Resource[] {
     return Array.isArray(x) && x[0] instanceof Resource;
 }
@@ -233,19 +406,83 @@ class Resource {
         );
     }
 
+    _whole?: Promise<Uint8Array>   /* from a server that does not do ranges */
+
+    /**
+     * `size` bytes at `offset`; with a range request. If the server ignores
+     * ranges, the whole content is fetched once, and kept for later ranges.
+     * @param transferred told how many bytes were actually read or downloaded
+     *   for it (the whole content, for the range that fetched it)
+     */
+    async range(offset: number, size: number, transferred: (bytes: number) => void = () => {}) {
+        let part = await this.fileRange(offset, size);
+        if (part) { transferred(part.length); return part; }
+        if (this._whole) return (await this._whole).slice(offset, offset + size);
+
+        let response = await fetch(this.uri, {headers: {Range: `bytes=${offset}-${offset + size - 1}`}});
+        if (!response.ok)
+            throw new Error(`cannot fetch '${this.uri}': ${response.status} ${response.statusText}`);
+        if (response.status === 206) {
+            part = new Uint8Array(await response.arrayBuffer());
+            transferred(part.length);
+            return part;
+        }
+
+        if (this._whole) response.body?.cancel();   /* another range got here first */
+        else this._whole = response.arrayBuffer().then(ab => {
+            transferred(ab.byteLength);
+            return new Uint8Array(ab);
+        });
+        return (await this._whole).slice(offset, offset + size);
+    }
+
+    /** The content as a stream, reporting download progress as it is read. */
+    async stream(progress: (p: DownloadProgress) => void = () => {}): Promise<ReadableStream<Uint8Array>> {
+        let fl = await this.file();
+        if (fl) return new Blob([fl]).stream();
+
+        progress({uri: this.uri, total: 1, downloaded: 0}); /* dummy entry */
+        var response = await fetch(this.uri),
+            total = +response.headers.get('Content-Length'), downloaded = 0, uri = this.uri;
+        return response.body.pipeThrough(new TransformStream<Uint8Array, Uint8Array>({
+            transform(chunk, ctl) {
+                downloaded += chunk.length;
+                progress({uri, total, downloaded});
+                ctl.enqueue(chunk);
+            }
+        }));
+    }
+
     async prefetch(progress: (p: DownloadProgress) => void = () => {}) {
         return new ResourceBlob(await this.blob(progress), this.uri);
     }
 
     /** fast-path when fs is available */
     async file() {
-        if (this.uri.startsWith('file://')) {
-            const fs = await import(/* webpackIgnore: true */ 'fs').catch<null>(() => null);
-            if (fs?.promises?.readFile)
-                return fs.promises.readFile(new URL(this.uri).pathname);
+        const fs = await this._fs();
+        if (fs?.promises?.readFile)
+            return fs.promises.readFile(new URL(this.uri).pathname);
+    }
+
+    /** Same, for a range: reads just that part of the file. */
+    async fileRange(offset: number, size: number) {
+        const fs = await this._fs();
+        if (fs?.promises?.open) {
+            let fh = await fs.promises.open(new URL(this.uri).pathname, 'r');
+            try {
+                let buf = new Uint8Array(size),
+                    {bytesRead} = await fh.read(buf, 0, size, offset);
+                return bytesRead < size ? buf.subarray(0, bytesRead) : buf;
+            }
+            finally { await fh.close(); }
         }
     }
 
+    async _fs() {
+        if (this.uri.startsWith('file://'))
+            return await import(/* webpackIgnore: true */ 'fs').catch<null>(() => null);
+    }
+
 }
 
 class ResourceBlob extends Resource {
@@ -255,10 +492,150 @@ class ResourceBlob extends Resource {
         this._blob = blob;
     }
     async blob() { return this._blob; }
+    async stream() { return this._blob.stream(); }
+    async range(offset: number, size: number, transferred: (bytes: number) => void = () => {}) {
+        let part = new Uint8Array(await this._blob.slice(offset, offset + size).arrayBuffer());
+        transferred(part.length);
+        return part;
+    }
+}
+
+/** Leading bytes of compressed formats. */
+const MAGIC: [string, number[]][] = [
+    ['gzip', [0x1f, 0x8b]],
+    ['zstd', [0x28, 0xb5, 0x2f, 0xfd]],
+    ['xz',   [0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00]]
+];
+
+/** Bytes needed to tell any of `MAGIC` apart. */
+const SNIFF_LEN = Math.max(...MAGIC.map(([, m]) => m.length));
+
+/**
+ * Tells the compression format of a stream by its first bytes; reads as many
+ * chunks as it takes to get `SNIFF_LEN` of them (or to the end of the stream).
+ * @returns the format (`undefined` if not compressed) and the stream, whole
+ */
+async function sniffCompression(stream: ReadableStream<Uint8Array>): Promise<[string | undefined, ReadableStream<Uint8Array>]> {
+    let reader = stream.getReader(), chunks: Uint8Array[] = [], size = 0, done = false;
+    while (size < SNIFF_LEN) {
+        let r = await reader.read();
+        if (r.done) { done = true; break; }
+        if (r.value.length === 0) continue;
+        chunks.push(r.value);
+        size += r.value.length;
+    }
+    let head = concatChunks(chunks, size),
+        format = MAGIC.find(([, m]) => m.every((b, i) => head[i] === b))?.[0];
+    return [format, new ReadableStream<Uint8Array>({
+        start(ctl) {
+            for (let c of chunks) ctl.enqueue(c);
+            chunks = [];
+            if (done) ctl.close();
+        },
+        async pull(ctl) {
+            let r = await reader.read();
+            if (r.done) ctl.close();
+            else ctl.enqueue(r.value);
+        },
+        cancel(reason) {
+            return reader.cancel(reason);
+        }
+    })];
+}
+
+function concatChunks(chunks: Uint8Array[], size: number) {
+    if (chunks.length === 1) return chunks[0];
+    let out = new Uint8Array(size), at = 0;
+    for (let c of chunks) { out.set(c, at); at += c.length; }
+    return out;
+}
+
+/** where the per-file volumes of an indexed lazy mount go, in each directory */
+const LAZY_DIR = '.lazy';
+
+type IndexNode = {files: Map<string, BundleIndex['files'][string]>, dirs: Map<string, IndexNode>};
+
+/** The index as a tree of directories; keyed by path (`''` is the root). */
+function indexTree(index: BundleIndex) {
+    let nodes = new Map<string, IndexNode>([['', {files: new Map, dirs: new Map}]]);
+    const node = (dir: string): IndexNode => {
+        let n = nodes.get(dir);
+        if (!n) {
+            nodes.set(dir, n = {files: new Map, dirs: new Map});
+            let parent = path.dirname(dir);
+            node(parent === '.' ? '' : parent).dirs.set(path.basename(dir), n);
+        }
+        return n;
+    };
+    for (let [fn, entry] of Object.entries(index.files)) {
+        let rel = fn.replace(/^\/+/, ''), dir = path.dirname(rel);
+        node(dir === '.' ? '' : dir).files.set(path.basename(rel), entry);
+    }
+    return nodes;
+}
+
+async function fetchEntry(index: BundleIndex, entry: BundleIndex['files'][string],
+                          transferred: (bytes: number) => void = () => {}) {
+    if (entry.uri) {
+        let content = await new Resource(entry.uri).fetch();
+        transferred(content.length);
+        return content;
+    }
+    if (!index.base) throw new Error('bundle index has offsets but no base');
+    return index.base.range(entry.offset ?? 0, entry.size, transferred);
+}
+
+/**
+ * Indexes the regular files of an uncompressed tar archive, so that it can
+ * serve as the base of a `BundleIndex`. Takes ustar, pax and GNU archives:
+ * a pax extended header (`x`) or a GNU long name (`L`) applies to the entry
+ * after it; the ustar name prefix is only read from POSIX headers (GNU ones
+ * keep other fields there). Global pax headers (`g`) are skipped.
+ */
+function indexTar(tar: Uint8Array): BundleIndex['files'] {
+    const td = new TextDecoder,
+          str = (at: number, len: number) => td.decode(tar.subarray(at, at + len)).replace(/\0.*$/s, ''),
+          num = (at: number, len: number) => (tar[at] & 0x80)
+              ? tar.subarray(at + 1, at + len).reduce((n, b) => n * 256 + b, tar[at] & 0x7f)  /* GNU base-256 */
+              : parseInt(str(at, len).trim() || '0', 8);
+    let files: BundleIndex['files'] = {}, longname: string, pax: {[key: string]: string} = {};
+    for (let at = 0; at + 512 <= tar.length && tar[at] !== 0; ) {
+        let type = String.fromCharCode(tar[at + 156]), data = at + 512, size = num(at + 124, 12);
+        if (type === 'x') pax = paxRecords(tar.subarray(data, data + size));
+        else if (type === 'L') longname = str(data, size);
+        else if (type !== 'g') {
+            let posix = td.decode(tar.subarray(at + 257, at + 263)) === 'ustar\0',
+                name = str(at, 100), prefix = posix ? str(at + 345, 155) : '',
+                fn = pax.path ?? longname ?? (prefix ? `${prefix}/${name}` : name);
+            if (pax.size !== undefined) size = +pax.size;
+            if (type === '0' || type === '\0' || type === '7')
+                files[fn.replace(/^\.\//, '')] = {size, offset: data};
+            longname = undefined;
+            pax = {};
+        }
+        at = data + Math.ceil(size / 512) * 512;
+    }
+    return files;
+}
+
+/** Records of a pax extended header: `"<length> <key>=<value>\n"` each, `length` in bytes. */
+function paxRecords(buf: Uint8Array) {
+    const td = new TextDecoder;
+    let records: {[key: string]: string} = {};
+    for (let at = 0; at < buf.length; ) {
+        let sp = buf.indexOf(0x20, at), len = sp < 0 ? 0 : parseInt(td.decode(buf.subarray(at, sp)), 10);
+        if (!(len > 0)) break;
+        let rec = td.decode(buf.subarray(sp + 1, at + len - 1)), eq = rec.indexOf('=');
+        if (eq > 0) records[rec.slice(0, eq)] = rec.slice(eq + 1);
+        at += len;
+    }
+    return records;
 }
 
 type DownloadProgress = { uri: string, total: number, downloaded: number };
 
+type FileStamp = {mtime: number, size: number, readonly: boolean};
+
 
 
 class DirectoryVolumeAdapter implements Volume {
@@ -266,6 +643,8 @@ class DirectoryVolumeAdapter implements Volume {
     options: {readonly?: boolean}
 
     mounts: {[subdir: string]: wasmer.Directory} = {}
+    volumes: {[subdir: string]: DirectoryVolumeAdapter} = {}
+    stamps = new Map<string, FileStamp>()   /* of files written from here */
 
     constructor(options?: DirectoryVolumeAdapter['options'])
     constructor(root: wasmer.Directory, options?: DirectoryVolumeAdapter['options'])
@@ -284,11 +663,27 @@ class DirectoryVolumeAdapter implements Volume {
     }
 
     writeFile(filename: string, content: string | Uint8Array): Promise<void> {
-        return this.options.readonly
+        let readonly = !!this.options.readonly,
+            size = typeof content === 'string' ? new TextEncoder().encode(content).length : content.length;
+        this.stamps.set(path.resolve('/', filename), {mtime: Date.now(), size, readonly});
+        return readonly
             ? this.root.writeFileRO(filename, content)
             : this.root.writeFile(filename, content);
     }
 
+    /**
+     * When and how big the file was written, if it was written through this
+     * adapter (or the one mounted where it is). `wasmer.Directory` keeps no
+     * times of its own; and writes by processes are not seen here, so only a
+     * `readonly` stamp says for sure what is in the file.
+     */
+    stat(filename: string): FileStamp | undefined {
+        let abs = path.resolve('/', filename),
+            dir = Object.keys(this.volumes).filter(d => abs.startsWith(`${d}/`))
+                        .reduce((a, d) => d.length > a.length ? d : a, '');
+        return dir ? this.volumes[dir].stat(abs.slice(dir.length)) : this.stamps.get(abs);
+    }
+
     readFile(filename: string): Promise<Uint8Array>
     readFile(filename: string, encoding: 'utf-8'): Promise<string>
 
@@ -323,6 +718,7 @@ class DirectoryVolumeAdapter implements Volume {
         await this.mkdir(path.dirname(dir), {recursive: true});
         this.root.mountDir(dir, vol.root);
         this.mounts[dir] = vol.root;
+        this.volumes[path.resolve('/', dir)] = vol;
     }
 }
 
@@ -361,4 +757,5 @@ class SubdirectoryVolume implements Volume {
 
 
 export { PackageManager, Resource, ResourceBlob, ResourceBundle, Symlink, Lazily,
-         DownloadProgress, DirectoryVolumeAdapter, SubdirectoryVolume }
\ No newline at end of file
+         BundleIndex, indexTar, DownloadProgress, DirectoryVolumeAdapter, SubdirectoryVolume,
+         FileStamp }
\ No newline at end of file
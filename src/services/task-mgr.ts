@@ -1,41 +1,243 @@
+import { EventEmitter } from 'events';
 import * as wasmer from '@wasmer/sdk';
+import { StdioBatch, StdioChannel, StdioChannelProps } from '../core/bits/stdio-ring';
+import { SignalVector, SignalVectorProps } from '../core/bits/signals';
 
 /**
  * Wraps a Wasmer instance and provides access to input/output streams.
+ * Output comes either as streams (`instance.stdout`, `instance.stderr`) or,
+ * if spawned with `stdio: 'ring'`, through shared memory (`stdio`).
+ * `signals` is the process' signal vector, for sending (or queueing) it signals;
+ * while there are `'signal'` listeners, they are told of each signal that
+ * becomes pending for it (until it exits).
  */
-class ChildProcess {
-    instance: wasmer.Instance
+class ChildProcess extends EventEmitter {
+    instance: wasmer.Instance & {stdio?: StdioChannelProps, signals?: SignalVectorProps}
     runtime?: wasmer.Runtime
     stdin: Stdin
+    stdio?: StdioChannel
+    signals?: SignalVector
+    spawnStats?: SpawnStats
+    _unobserve?: () => void
 
-    constructor(instance: wasmer.Instance, runtime?: wasmer.Runtime) {
+    constructor(instance: ChildProcess['instance'], runtime?: wasmer.Runtime) {
+        super();
         this.instance = instance;
         this.runtime = runtime;
         if (this.instance.stdin)
             this.stdin = new Stdin(this.instance.stdin.getWriter());
+        if (this.instance.stdio)
+            this.stdio = new StdioChannel(this.instance.stdio);
+        if (this.instance.signals)
+            this.signals = SignalVector.from(this.instance.signals);
+
+        this.on('newListener', ev => {
+            if (ev === 'signal' && this.signals && !this._unobserve) {
+                this.signals.on('signal', this._relaySignal);
+                this._unobserve = this.signals.observe();
+            }
+        });
+        this.on('removeListener', ev => {
+            if (ev === 'signal' && this._unobserve && this.listenerCount('signal') === 0) {
+                this._unobserve();
+                this._unobserve = undefined;
+                this.signals.off('signal', this._relaySignal);
+            }
+        });
     }
 
+    _relaySignal = (signum: number, value?: number) => this.emit('signal', signum, value);
+
     write(buf: string | Uint8Array) {
-        this.stdin.write(buf);
+        return this.stdin.write(buf);
     }
 
+    /**
+     * Feeds stdin from a source, as fast as the process takes it in, then
+     * closes it; see `Stdin.feed`.
+     * Paths are not taken: `wasmer.Directory` can only read files whole,
+     * which would defeat the bounded buffering.
+     * @param src a stream, Blob, or (async) iterable of chunks
+     */
+    async feed(src: StdinSource, opts: Partial<FeedOptions> = {}) {
+        if (typeof src === 'string')
+            throw new TypeError(`cannot feed from a path ('${src}'); pass a stream or Blob`);
+        return this.stdin.feed(src, opts);
+    }
+
+    /** Output as text; decoded per stream, so characters split across chunks come out whole. */
     async *read() {
-        let td = new TextDecoder();
+        let td = {out: new TextDecoder, err: new TextDecoder};
 
-        for await (let chunk of this.readRaw())
-            yield td.decode(chunk.value);
+        for await (let batch of this.readBatches())
+            for (let k of STREAMS) {
+                let s = batch[k] && td[k].decode(batch[k], {stream: true});
+                if (s) yield s;
+            }
+        for (let k of STREAMS) {
+            let s = td[k].decode();
+            if (s) yield s;
+        }
     }
 
     readRaw() {
-        return readCollate([this.instance.stdout, this.instance.stderr]);
+        return this.stdio ? this._readRing() : readCollate([this.instance.stdout, this.instance.stderr]);
+    }
+
+    /**
+     * Output in batches: each has all of the output that was available at
+     * the time, in one chunk per stream. (With streams, a batch is a single
+     * chunk of either.)
+     */
+    async *readBatches(): AsyncGenerator<StdioBatch> {
+        if (this.stdio) {
+            for (let batch: StdioBatch; batch = await this.stdio.readBatch(); )
+                yield batch;
+        }
+        else {
+            for await (let [chunk, idx] of readCollateTagged([this.instance.stdout, this.instance.stderr]))
+                yield {[STREAMS[idx]]: chunk.value};
+        }
+    }
+
+    async *_readRing() {
+        for await (let {out, err} of this.readBatches()) {
+            if (out) yield {done: false, value: out} as ReadableStreamReadResult<Uint8Array>;
+            if (err) yield {done: false, value: err} as ReadableStreamReadResult<Uint8Array>;
+        }
+    }
+
+    /**
+     * Writes output (of stdout and stderr both) to a sink as it comes, in
+     * coalesced writes, with flow control; see `OutputPipe`.
+     */
+    async pipeInto(out: PipeSink, opts: Partial<PipeOptions> = {}) {
+        let pipe = new OutputPipe(out, opts);
+        for await (let batch of this.readBatches()) {
+            pipe.push(batch);
+            await pipe.ready();
+        }
+        await pipe.end();
+        return pipe.stats;
+    }
+}
+
+
+/**
+ * Feeds output to a sink.
+ *  - Small chunks are coalesced: the sink is written to once `coalesceBytes`
+ *    are pending, or `coalesceMs` after the first of them came in.
+ *  - If the sink's `write` returns a promise, what it was given counts as
+ *    buffered until that settles. Once more than `highWater` bytes are
+ *    buffered, `ready()` holds the reader back until they are down to
+ *    `lowWater` -- and with it the process, once its pipe fills up.
+ *  - With `encoding`, the sink gets strings, decoded per stream.
+ */
+class OutputPipe {
+    sink: PipeSink
+    opts: PipeOptions
+    td?: {out: TextDecoder, err: TextDecoder}
+
+    pending: (Uint8Array | string)[] = []
+    pendingBytes = 0
+    buffered = 0    /* bytes given to the sink that it is not done with */
+    error: any
+    stats = {writes: 0, bytes: 0, pauses: 0}
+
+    _timer: ReturnType<typeof setTimeout>
+    _settled: () => void
+
+    constructor(sink: PipeSink, opts: Partial<PipeOptions> = {}) {
+        this.sink = sink;
+        this.opts = {...DEFAULT_PIPE_OPTIONS, ...opts};
+        if (this.opts.encoding)
+            this.td = {out: new TextDecoder(this.opts.encoding), err: new TextDecoder(this.opts.encoding)};
+    }
+
+    push(batch: StdioBatch) {
+        for (let k of STREAMS) {
+            let chunk = batch[k];
+            if (!chunk?.length) continue;
+            this.pending.push(this.td ? this.td[k].decode(chunk, {stream: true}) : chunk);
+            this.pendingBytes += chunk.length;
+        }
+        if (this.pendingBytes >= this.opts.coalesceBytes) this.flush();
+        else this._timer ??= setTimeout(() => this.flush(), this.opts.coalesceMs);
+    }
+
+    flush() {
+        clearTimeout(this._timer);
+        this._timer = undefined;
+
+        let n = this.pendingBytes,
+            data = this.td ? (this.pending as string[]).join('')
+                           : concat(this.pending as Uint8Array[], n);
+        this.pending = [];
+        this.pendingBytes = 0;
+        if (!data.length) return;
+
+        this.stats.writes++;
+        this.stats.bytes += n;
+        let ret = this.sink.write(data) as PromiseLike<unknown> | void;
+        if (ret && typeof ret.then === 'function') {
+            this.buffered += n;
+            ret.then(() => this._done(n), e => { this.error ??= e; this._done(n); });
+        }
+    }
+
+    /** Resolves when the sink can take more; rejects if a write failed. */
+    async ready() {
+        if (this.buffered > this.opts.highWater) {
+            this.stats.pauses++;
+            while (this.buffered > this.opts.lowWater) await this._settle();
+        }
+        if (this.error) throw this.error;
     }
 
-    async pipeInto(out: {write: (buf: Uint8Array) => void}) {
-        for await (let chunk of this.readRaw())
-            out.write(chunk.value);
+    /** Writes what is left and waits for the sink to finish. */
+    async end() {
+        if (this.td)
+            for (let k of STREAMS) this.pending.push(this.td[k].decode());
+        this.flush();
+        while (this.buffered > 0) await this._settle();
+        if (this.error) throw this.error;
+    }
+
+    _done(n: number) {
+        this.buffered -= n;
+        this._settled?.();
+    }
+
+    _settle() {
+        return new Promise<void>(resolve => this._settled = resolve);
     }
 }
 
+type PipeSink = {write(data: Uint8Array | string): void | PromiseLike<unknown>};
+
+type PipeOptions = {
+    coalesceMs: number
+    coalesceBytes: number
+    highWater: number
+    lowWater: number
+    encoding?: string     /* e.g. `'utf-8'`; the sink gets strings */
+};
+
+const DEFAULT_PIPE_OPTIONS: PipeOptions = {
+    coalesceMs: 8, coalesceBytes: 64 << 10, highWater: 1 << 20, lowWater: 256 << 10
+};
+
+const STREAMS = ['out', 'err'] as const;
+
+
+/** What it took to get the program to the init process. */
+type SpawnStats = {
+    cached: boolean         /* the compiled module was reused */
+    bytesCopied: number     /* program bytes copied on the way (none go to the init process) */
+    compileMs: number
+    compileSavedMs: number  /* original compile time of a reused module */
+};
+
 
 class Stdin {
     writer: WritableStreamDefaultWriter<Uint8Array>
@@ -50,10 +252,84 @@ class Stdin {
             buf = this.te.encode(buf);
         return this.writer.write(buf);
     }
+
+    close() {
+        return this.writer.close();
+    }
+
+    /**
+     * Copies everything from `src`, in chunks of at most `chunkSize`, then
+     * closes. Writes are not waited for one by one, but no more than
+     * `highWater` bytes are left in flight: past that, reading from `src`
+     * waits for the process to take them in.
+     */
+    async feed(src: StdinSource, opts: Partial<FeedOptions> = {}) {
+        let o = {...DEFAULT_FEED_OPTIONS, ...opts},
+            inflight = 0, written = 0, error: any, settled: () => void;
+        const drained = () => new Promise<void>(resolve => settled = resolve);
+
+        try {
+            for await (let chunk of chunksOf(src)) {
+                if (typeof chunk === 'string') chunk = this.te.encode(chunk);
+                for (let at = 0; at < chunk.length; at += o.chunkSize) {
+                    let part = chunk.subarray(at, at + o.chunkSize), n = part.length;
+                    while (inflight + n > o.highWater && inflight > 0) await drained();
+                    if (error) throw error;
+                    inflight += n;
+                    this.writer.write(part).then(
+                        () => { inflight -= n; written += n; settled?.(); },
+                        e => { inflight -= n; error ??= e; settled?.(); });
+                }
+            }
+            while (inflight > 0) await drained();
+            if (error) throw error;
+            await this.writer.close();
+        }
+        catch (e) {
+            await this.writer.abort(e).catch(() => {});
+            throw e;
+        }
+        return written;
+    }
+}
+
+type StdinSource = ReadableStream<Uint8Array> | Blob | Uint8Array |
+                   AsyncIterable<Uint8Array | string> | Iterable<Uint8Array | string>;
+
+type FeedOptions = {
+    chunkSize: number
+    highWater: number
+};
+
+const DEFAULT_FEED_OPTIONS: FeedOptions = {chunkSize: 64 << 10, highWater: 1 << 20};
+
+function chunksOf(src: StdinSource): AsyncIterable<Uint8Array | string> | Iterable<Uint8Array | string> {
+    if (src instanceof Uint8Array) return [src];
+    if (src instanceof Blob) src = src.stream();
+    if (src instanceof ReadableStream) return streamChunks(src);
+    return src;
+}
+
+/** (not every engine has async iteration on `ReadableStream`) */
+async function *streamChunks(s: ReadableStream<Uint8Array>) {
+    let reader = s.getReader();
+    try {
+        for (let r: ReadableStreamReadResult<Uint8Array>; !(r = await reader.read()).done; )
+            yield r.value;
+    }
+    finally {
+        reader.releaseLock();
+    }
 }
 
 
 async function *readCollate(s: ReadableStream[]) {
+    for await (let [chunk] of readCollateTagged(s))
+        yield chunk;
+}
+
+/** Chunks from several streams, as they come, each with the index of its stream. */
+async function *readCollateTagged(s: ReadableStream[]) {
     const r = s.map(s => s.getReader()),
           poll = async (r: ReadableStreamDefaultReader<any>, i: number) =>
                  [await r.read(), i] as [ReadableStreamReadResult<any>, number];
@@ -66,12 +342,19 @@ async function *readCollate(s: ReadableStream[]) {
                 delete p[idx];
             }
             else {
-                yield chunk;
+                yield [chunk, idx] as [ReadableStreamReadResult<any>, number];
                 p[idx] = poll(r[idx], idx);
             }
         } catch (e) { console.warn('[readCollate]', e); }
     }
 }
 
+function concat(chunks: Uint8Array[], size: number) {
+    if (chunks.length === 1) return chunks[0];
+    let out = new Uint8Array(size), at = 0;
+    for (let c of chunks) { out.set(c, at); at += c.length; }
+    return out;
+}
+
 
-export { ChildProcess }
\ No newline at end of file
+export { ChildProcess, SpawnStats, OutputPipe, PipeSink, PipeOptions, StdinSource, FeedOptions }
\ No newline at end of file
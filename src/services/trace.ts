@@ -0,0 +1,68 @@
+import { Tracer, TraceRing, TRACE_EVENT_NAMES, TRACE_CHANNEL }
+       from '../core/bits/trace';
+
+
+/**
+ * Gathers the trace rings of all workers (and of the main thread) and
+ * exports them as a Chrome/Perfetto trace, one track per worker.
+ */
+class TraceCollector {
+    chan: BroadcastChannel
+    rings = new Map<ArrayBufferLike, {name: string, ring: TraceRing}>()
+    enabled = false
+    capacity: number
+
+    constructor() {
+        this.chan = new BroadcastChannel(TRACE_CHANNEL);
+        this.chan.addEventListener('message', ({data}) => {
+            switch (data.type) {
+            case 'ring':
+                this.add(data.name, new TraceRing(data.buffer)); break;
+            case 'hello':   /* a worker started after `enable` */
+                if (this.enabled) this.enable(this.capacity); break;
+            }
+        });
+        Tracer.local.listen();
+    }
+
+    enable(capacity?: number) {
+        this.enabled = true;
+        this.capacity = capacity;
+        this.chan.postMessage({type: 'enable', capacity});
+    }
+
+    disable() {
+        this.enabled = false;
+        this.chan.postMessage({type: 'disable'});
+    }
+
+    add(name: string, ring: TraceRing) {
+        this.rings.set(ring.buffer, {name, ring});
+    }
+
+    /**
+     * Produces the JSON Object Format of the Trace Event Format; can be
+     * loaded into `chrome://tracing` or https://ui.perfetto.dev.
+     */
+    export() {
+        let traceEvents = [], tid = 0;
+        for (let {name, ring} of this.rings.values()) {
+            tid++;
+            traceEvents.push({ph: 'M', name: 'thread_name', pid: 1, tid, args: {name}});
+            for (let e of ring.events())
+                traceEvents.push({
+                    name: TRACE_EVENT_NAMES[e.ev] ?? `event ${e.ev}`,
+                    ph: e.dur ? 'X' : 'i', ts: e.ts, dur: e.dur || undefined,
+                    pid: 1, tid, args: {a0: e.a0, a1: e.a1}
+                });
+        }
+        return {traceEvents, displayTimeUnit: 'ms'};
+    }
+
+    exportJSON() {
+        return JSON.stringify(this.export());
+    }
+}
+
+
+export { TraceCollector }
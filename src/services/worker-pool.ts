@@ -0,0 +1,145 @@
+/**
+ * Keeps Web Workers running the kernel's worker script ready to go, with
+ * the SDK already imported and, once the pool knows the SDK's memory (`init`),
+ * instantiated on it (see `prewarm` in `worker.webpack.js`), so that starting
+ * a process or thread does not wait for either.
+ *
+ * Wasmer's thread pool creates its workers with `new Worker(workerUrl)`;
+ * `install` has those constructions served from the pool. The init process
+ * uses one, with the memory from its own `init` message; the main thread
+ * uses one while it starts the init processes (see `System.startup`).
+ *
+ * The number of spare workers starts at `size`, and grows (up to `max`)
+ * whenever the pool is found empty. Spares that have not been instantiated
+ * yet shrink back as they sit idle for `idleMs`; instantiated ones are kept,
+ * since `wasmer.init` sets up a thread (stack and TLS) in the shared memory,
+ * which is not given back when a worker is terminated.
+ */
+class WorkerPool {
+    url: string
+    sdkUrl: string
+    opts: WorkerPoolOptions
+
+    spares: {worker: Worker, since: number}[] = []   /* oldest first */
+    target: number
+    type: WorkerType     /* of spares; corrected by the first `take` if needed */
+    init?: WorkerPoolInit   /* for `wasmer.init` in spares */
+    stats = {warm: 0, cold: 0, evicted: 0}
+
+    _timer: ReturnType<typeof setInterval>
+    _installed?: Function
+
+    constructor(url: string | URL, sdkUrl: string, opts: Partial<WorkerPoolOptions> = {},
+                init?: WorkerPoolInit) {
+        this.url = new URL(url, location.href).href;
+        this.sdkUrl = sdkUrl;
+        this.opts = {...DEFAULT_OPTIONS, ...opts};
+        this.opts.max = Math.max(this.opts.max, this.opts.size);
+        this.target = this.opts.size;
+        this.type = this.url.endsWith('.mjs') ? 'module' : 'classic';
+        this.init = init;
+    }
+
+    /** Has spares instantiate the SDK on `init.memory`, those there are and those to come. */
+    initWith(init: WorkerPoolInit) {
+        this.init = init;
+        for (let {worker} of this.spares) this._prewarm(worker);
+    }
+
+    start() {
+        this.fill();
+        this._timer ??= setInterval(() => this.evict(), this.opts.idleMs);
+        return this;
+    }
+
+    /** Terminates the spares, and has workers created as usual again. */
+    stop() {
+        clearInterval(this._timer);
+        this._timer = undefined;
+        this.target = 0;
+        this.drop();
+        if (this._installed && globalThis.Worker === this._installed)
+            globalThis.Worker = NativeWorker;
+        this._installed = undefined;
+    }
+
+    drop() {
+        for (let {worker} of this.spares.splice(0)) worker.terminate();
+    }
+
+    /** Hands out a worker; a warm one if there is any. */
+    take(opts?: WorkerOptions) {
+        if (!this._timer) return this.create(opts);   /* stopped */
+        if (opts?.type && opts.type !== this.type) {  /* spares were guessed wrong */
+            this.type = opts.type;
+            this.drop();
+        }
+        let spare = this.spares.pop();
+        if (spare) this.stats.warm++;
+        else {
+            this.stats.cold++;
+            this.target = Math.min(this.target + 1, this.opts.max);
+        }
+        queueMicrotask(() => this.fill());
+        return spare?.worker ?? this.create(opts);
+    }
+
+    create(opts?: WorkerOptions) {
+        let worker = new NativeWorker(this.url, {type: this.type, ...opts});
+        this._prewarm(worker);
+        return worker;
+    }
+
+    _prewarm(worker: Worker) {
+        worker.postMessage({type: 'prewarm', sdkUrl: this.sdkUrl, ...this.init});
+    }
+
+    fill() {
+        while (this.spares.length < this.target)
+            this.spares.push({worker: this.create({name: 'wasik-spare'}), since: performance.now()});
+    }
+
+    /** Lets go of one spare that has been idle for a while, down to `size`. */
+    evict() {
+        if (this.init) return;   /* would leave its thread behind */
+        let oldest = this.spares[0];
+        if (this.spares.length > this.opts.size && oldest &&
+                performance.now() - oldest.since >= this.opts.idleMs) {
+            this.spares.shift().worker.terminate();
+            this.target = Math.max(this.target - 1, this.opts.size);
+            this.stats.evicted++;
+        }
+    }
+
+    /**
+     * Serves `new Worker(url)` from this pool, for this pool's URL;
+     * other workers are created as usual.
+     */
+    install() {
+        const pool = this;
+        function Worker(url: string | URL, opts?: WorkerOptions) {
+            return new URL(url, location.href).href === pool.url
+                ? pool.take(opts) : new NativeWorker(url, opts);
+        }
+        Worker.prototype = NativeWorker.prototype;
+        globalThis.Worker = this._installed = Worker as any;
+        return this.start();
+    }
+}
+
+
+type WorkerPoolOptions = {
+    size: number     /* spare workers to keep at all times */
+    max: number      /* most spare workers to keep after a burst */
+    idleMs: number   /* spares above `size` are terminated after this long */
+};
+
+/** What `wasmer.init` is given in spares; the SDK's module and shared memory. */
+type WorkerPoolInit = {module: any, memory: WebAssembly.Memory};
+
+const DEFAULT_OPTIONS: WorkerPoolOptions = {size: 2, max: 8, idleMs: 30000};
+
+const NativeWorker = globalThis.Worker;
+
+
+export { WorkerPool, WorkerPoolOptions, WorkerPoolInit }
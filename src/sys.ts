@@ -1,7 +1,10 @@
+import path from "path";
 import * as wasmer from "@wasmer/sdk";
 import { init, WasmerInitInput } from "@wasmer/sdk";
 
-import { ChildProcess, DirectoryVolumeAdapter, InitProcess } from './services';
+import { ChildProcess, DirectoryVolumeAdapter, InitProcess, InitProcessGroup, InitOptions,
+         SpawnStats, WorkerPool } from './services';
+import { ModuleCache, LookupInfo, LruMap } from './core/bits/module-cache';
 
 
 
@@ -20,7 +23,9 @@ class System {
         worker: string
     }
 
-    init: InitProcess
+    init: InitProcess | InitProcessGroup
+    modules = ModuleCache.shared
+    programs = new LruMap<string, string>(ModuleCache.shared.limits.modules)   /* stamp -> content key */
     mem: WebAssembly.Memory
     vfs: DirectoryVolumeAdapter
     cwd: string
@@ -32,7 +37,15 @@ class System {
         this.uris = uris;
     }
 
-    async startup(initOptions: WasmerInitInput = {}) {
+    /**
+     * @param opts.pool sizing of the pre-warmed worker pool (see `WorkerPool`);
+     *   off unless given. With it, the init processes are pre-warmed as well:
+     *   their workers import the SDK while it is initialized here, and then
+     *   instantiate it on the same memory
+     * @param opts.concurrency spawns in progress at once, per init process
+     * @param opts.shards number of init processes to spread spawns over
+     */
+    async startup(initOptions: WasmerInitInput = {}, opts: InitOptions & {shards?: number} = {}) {
         let iin = {
             module: this.uris.wasmBindgen, 
             sdkUrl: this.uris.sdk,
@@ -40,10 +53,18 @@ class System {
             ...initOptions
         };
 
+        let shards = Math.max(opts.shards ?? 1, 1),
+            pool = opts.pool && iin.workerUrl
+                ? new WorkerPool(iin.workerUrl, iin.sdkUrl, {size: shards, max: shards}).install()
+                : undefined;
+
         let iout = await init(iin);
         this.mem = iout.memory;
+        pool?.initWith({module: iin.module, memory: this.mem});
 
-        this.init = new InitProcess(iin, this.mem);
+        this.init = shards > 1 ? new InitProcessGroup(shards, iin, this.mem, opts)
+                               : new InitProcess(iin, this.mem, opts);
+        pool?.stop();
 
         // Default setup
         this.vfs = new DirectoryVolumeAdapter(new wasmer.Directory);
@@ -54,18 +75,75 @@ class System {
     }
 
 
-    async runWasix(bin: Uint8Array | ArrayBuffer | URL | string, runOpts: wasmer.RunOptions) {
+    /**
+     * Programs are compiled here, once per content (see `ModuleCache`), and
+     * handed to the init process as `WebAssembly.Module`s -- no bytes are
+     * copied across. `ChildProcess.spawnStats` tells how it went.
+     * @param bin a program; a string is a path in the VFS
+     * @param runOpts Wasmer's options, plus `preload`: names of shared
+     *   libraries that the program is going to `dlopen`, to compile ahead of time;
+     *   `stdio: 'ring'` has output come through shared memory (see `StdioChannel`)
+     */
+    async runWasix(bin: WebAssembly.Module | Uint8Array | ArrayBuffer | URL | string,
+                   runOpts: wasmer.RunOptions & {preload?: string[], stdio?: 'stream' | 'ring'}) {
         if (!this.init) await this.startup();
 
-        bin = await this._bin(bin);
+        let {module, stats} = await this._module(bin);
 
-        let instance = await this.init.spawn(bin, {
+        let instance = await this.init.spawn(module, {
             mount: this.vfs.mounts,
             cwd: this.cwd,
             env: this.env,
             ...runOpts, 
         });
-        return new ChildProcess(instance);
+        let p = new ChildProcess(instance);
+        p.spawnStats = stats;
+        return p;
+    }
+
+    /**
+     * The content is only hashed (see `ModuleCache`) for raw bytes, and the
+     * first time a program is seen at a given stamp: a VFS path with its
+     * mtime and size (when it is read-only, see `DirectoryVolumeAdapter.stat`),
+     * or a URL with its `ETag` or `Last-Modified`. After that, the stamp
+     * leads to the module without even reading the file.
+     */
+    async _module(bin: WebAssembly.Module | Uint8Array | ArrayBuffer | URL | string) {
+        let stats: SpawnStats = {cached: false, bytesCopied: 0, compileMs: 0, compileSavedMs: 0};
+        if (bin instanceof WebAssembly.Module)
+            return {module: bin, stats: {...stats, cached: true}};
+
+        let info: LookupInfo = {}, stamp: string, response: Response;
+        if (typeof bin === 'string') {
+            let st = this.vfs.stat(bin);
+            if (st?.readonly) stamp = `${path.resolve('/', bin)}@${st.mtime}:${st.size}`;
+        }
+        else if (bin instanceof URL) {
+            response = await fetch(bin);
+            let v = response.headers.get('ETag') ?? response.headers.get('Last-Modified');
+            if (v) stamp = `${bin.href}@${v}`;
+        }
+
+        let key = stamp && this.programs.get(stamp),
+            module = key && await this.modules.getByKey(key, info);
+        if (module) {
+            response?.body?.cancel();
+        }
+        else {
+            let bytes = response ? await response.arrayBuffer() : await this._bin(bin);
+            module = await this.modules.get(
+                bytes instanceof Uint8Array ? bytes : new Uint8Array(bytes), info);
+            if (stamp) this.programs.set(stamp, info.key);
+            /* (reading from the VFS copies the file out of Wasmer's memory) */
+            if (typeof bin === 'string') stats.bytesCopied += bytes.byteLength;
+        }
+        stats.bytesCopied += info.bytesCopied ?? 0;
+        if (info.hit) {
+            stats.cached = true;
+            stats.compileSavedMs = this.modules.compileTime(info.key);
+        }
+        else stats.compileMs = info.compileMs;
+        return {module, stats};
     }
 
     /**
@@ -4,6 +4,14 @@
 //
 import type * as wasmer from "@wasmer/sdk";
 import './init';
+import { Tracer, TraceEvent } from './core/bits/trace';
+import { DynamicLibrary } from './core/bits/dyld';
+import { LibraryIndex, preloadDependencies } from './core/bits/ldcache';
+import { ModuleCache } from './core/bits/module-cache';
+import { WorkerPool, WorkerPoolOptions } from './services/worker-pool';
+import { StdioChannel, pumpInto } from './core/bits/stdio-ring';
+import { FsHookChannel } from './core/bits/fs-hook-channel';
+import { SignalTable, SignalTableProps, SIGVEC_ENV } from './core/bits/signals';
 
 
 class WasikThreadPoolWorker {
@@ -14,10 +22,36 @@ class WasikThreadPoolWorker {
         this.wasmer = wasmer;
     }
 
-    async init(id: number, iin: wasmer.WasmerInitInput) {
-        await this.wasmer.init(iin);
+    spawns = new Limiter(DEFAULT_SPAWN_CONCURRENCY)
+
+    /**
+     * @param opts (init process only) `pool` keeps workers for Wasmer's
+     *   thread pool pre-warmed, see `WorkerPool`; `concurrency` is the
+     *   number of spawns that may be in progress at once.
+     *   (all workers) `signals` is the `SignalTable`; `modules` are the
+     *   preloaded libraries, by path (see `ModuleCache.alias`). Both are
+     *   passed on to every worker created from this one, the latter as of
+     *   the time it is created; `prewarmed` says that `wasmer.init` was
+     *   run on `iin.memory` already, by a `WorkerPool` spare
+     */
+    async init(id: number, iin: wasmer.WasmerInitInput,
+               opts: {pool?: Partial<WorkerPoolOptions>, concurrency?: number,
+                      signals?: SignalTableProps,
+                      modules?: [string, WebAssembly.Module][],
+                      prewarmed?: boolean} = {}) {
+        if (!opts.prewarmed) await this.wasmer.init(iin);
         // @ts-ignore
         this.worker = id ? new this.wasmer.ThreadPoolWorker(id) : {}
+        if (!id && opts.pool && iin.workerUrl)
+            new WorkerPool(iin.workerUrl, iin.sdkUrl, opts.pool,
+                           {module: iin.module, memory: iin.memory}).install();
+        if (opts.concurrency) this.spawns.limit = opts.concurrency;
+        if (opts.signals) SignalTable.shared = SignalTable.from(opts.signals);
+        for (let [path, mod] of opts.modules ?? []) ModuleCache.shared.byPath.set(path, mod);
+        onNewWorker(w => {
+            passOnInit(w, () => ({signals: opts.signals, modules: [...ModuleCache.shared.byPath]}));
+            closeFsHookChannels(w);
+        });
     }
 
     async consume(messages: (ThreadPoolWorkerMessage | SpawnRequest)[]) {
@@ -28,7 +62,10 @@ class WasikThreadPoolWorker {
 
     async handleMessage(msg: ThreadPoolWorkerMessage | SpawnRequest) {
         if (msg.type === "spawn") {
-            await this.spawn(msg);
+            /* not awaited: spawns proceed concurrently (up to a limit),
+               and do not hold up the messages behind them */
+            this.spawns.run(() => this.spawn(msg))
+                .catch(e => msg.port.postMessage({error: `${e}`}));
         }
         else {
             await this.worker.handle(msg);
@@ -45,21 +82,91 @@ class WasikThreadPoolWorker {
     }
 
     async spawn(msg: SpawnRequest) {
-        const { bin, runOpts } = msg;
-        if (runOpts?.mount) {
+        const { bin, runOpts = {} } = msg,
+              stdio = runOpts.stdio,
+              t0 = Tracer.local.begin();
+        delete runOpts.stdio;
+        if (runOpts.mount) {
             /** @todo `mount` may contain `DirectoryInit` entries as well */
             runOpts.mount = Object.fromEntries(Object.entries(runOpts.mount)
                 .map(([k, v]) => [k, this.Directory_borrowFrom(v)]));
         }
-        if (runOpts?.runtime) {
+        if (runOpts.runtime) {
             runOpts.runtime = this.Runtime_borrowFrom(runOpts.runtime);
         }
-        let p = await this.wasmer.runWasix(bin, runOpts ?? {});
+        await this.preloadLibraries(bin, runOpts);
+
+        /* the process' signal vector; its threads find it through the environment.
+           Released at exit, i.e. once both of its output streams have ended
+           (the SDK has no other sign of it that leaves the streams to the host) */
+        let table = SignalTable.shared, slot = table ? table.allocate() : -1,
+            release = () => { if (slot >= 0) table.release(slot); slot = -1; };
+        if (slot >= 0) runOpts.env = {...runOpts.env, [SIGVEC_ENV]: `${slot}`};
+
+        let p: wasmer.Instance;
+        try { p = await this.wasmer.runWasix(bin, runOpts); }
+        catch (e) { release(); throw e; }
+        Tracer.local.end(TraceEvent.SPAWN_WORKER, t0);
+
+        let signals = slot >= 0 ? table.vector(slot).to() : undefined;
         // send process pipes back to sender
-        msg.port.postMessage(
-            {stdin: p.stdin, stdout: p.stdout, stderr: p.stderr},
-            [p.stdin, p.stdout, p.stderr].filter(x => x)
-        );
+        if (stdio === 'ring') {
+            /* output is pumped into shared memory here, rather than each
+               chunk being posted to the sender */
+            let chan = StdioChannel.create();
+            Promise.all([pumpInto(p.stdout, chan.out), pumpInto(p.stderr, chan.err)])
+                .finally(release);
+            msg.port.postMessage({stdin: p.stdin, stdio: chan.to(), signals},
+                                 [p.stdin].filter(x => x));
+        }
+        else {
+            let ends = 0, ended = () => { if (++ends === 2) release(); },
+                stdout = onEnd(p.stdout, ended), stderr = onEnd(p.stderr, ended);
+            msg.port.postMessage(
+                {stdin: p.stdin, stdout, stderr, signals},
+                [p.stdin, stdout, stderr].filter(x => x)
+            );
+        }
+    }
+
+    /**
+     * Compiles the program's shared libraries (and theirs, transitively)
+     * before it starts, so that `dlopen` does not have to.
+     * Roots are the `needed` entries of the program's `dylink.0` section, plus
+     * `runOpts.preload` for libraries that are `dlopen`ed by name.
+     */
+    async preloadLibraries(bin: SpawnRequest['bin'], runOpts: SpawnRequest['runOpts']) {
+        let roots = [...(runOpts?.preload ?? []),
+                     ...DynamicLibrary.parseDylink(bin).needed];
+        delete runOpts?.preload;
+        if (roots.length === 0 || !runOpts?.mount) return;
+
+        let mount = runOpts.mount as {[dir: string]: wasmer.Directory},
+            vol = mountedVolume(mount);
+        try {
+            let index = await this.libraryIndex(mount, vol, roots);
+            await preloadDependencies(roots, index, vol.readFile);
+        }
+        catch (e) { console.warn('[ld] preload failed;', e); }
+    }
+
+    libraryIndexes = new Map<string, Promise<LibraryIndex>>()
+
+    /**
+     * The `LibraryIndex` of a set of mounts, kept from one spawn to the next
+     * (like `ld.so.cache`); listed again when `roots` are not all in there,
+     * in case they were installed since.
+     */
+    async libraryIndex(mount: {[dir: string]: wasmer.Directory},
+                       vol: ReturnType<typeof mountedVolume>, roots: string[]) {
+        let key = Object.entries(mount).map(([dir, d]) => `${dir}=${d['__wbg_ptr']}`).sort().join(),
+            cached = this.libraryIndexes.get(key),
+            index = cached && await cached.catch(() => undefined);
+        if (index?.has(roots)) return index;
+
+        let p = LibraryIndex.scan(vol.readdir);
+        this.libraryIndexes.set(key, p);
+        return p;
     }
 
     Directory_borrowFrom(wbgobj: any) {
@@ -76,7 +183,10 @@ class WasikThreadPoolWorker {
 
 type wptr = number
 type ThreadPoolWorkerMessage = any
-type SpawnRequest = {bin: Uint8Array, runOpts: wasmer.RunOptions, port: MessagePort}
+type SpawnRequest = {bin: Uint8Array | WebAssembly.Module,
+                     runOpts: wasmer.RunOptions & {preload?: string[], stdio?: StdioMode},
+                     port: MessagePort}
+type StdioMode = 'stream' | 'ring'
 
 /** Like `<Class>.__wrap` but without finalization. */
 function borrow<Class extends object>(ptr: wptr, clas: {prototype: Class}) {
@@ -90,16 +200,116 @@ function borrowFrom<Class extends object>(wbgobj: any, clas: {prototype: Class})
     return borrow<Class>(wbgobj.__wbg_ptr, clas);
 }
 
+/** Calls `cb` once `stream` has been read to the end (right away if there is none). */
+function onEnd<T>(stream: ReadableStream<T> | undefined, cb: () => void) {
+    if (!stream) { cb(); return stream; }
+    return stream.pipeThrough(new TransformStream<T, T>({flush: cb}));
+}
+
+/**
+ * Has `setup` called on every worker created from here on. Wasmer creates
+ * its thread pool workers with `new Worker`, so this is how to reach them.
+ */
+function onNewWorker(setup: (w: Worker) => void) {
+    const Base = globalThis.Worker;
+    if (!Base) return;
+    function Worker(url: string | URL, opts?: WorkerOptions) {
+        let w: Worker = new Base(url, opts);
+        setup(w);
+        return w;
+    }
+    Worker.prototype = Base.prototype;
+    globalThis.Worker = Worker as any;
+}
+
+/** Adds `props()` to the `init` message of `w` (which Wasmer sends). */
+function passOnInit(w: Worker, props: () => object) {
+    let post = w.postMessage;
+    w.postMessage = function (msg: any, ...rest: any[]) {
+        if (msg?.type === 'init') msg = {...msg, ...props()};
+        return post.call(this, msg, ...rest);
+    };
+}
+
+/**
+ * Closes the `FsHookChannel`s registered by `w`, and by the workers it
+ * created (whose registrations it forwards), once `w` is terminated; the
+ * main thread then stops serving them.
+ */
+function closeFsHookChannels(w: Worker) {
+    let channels: FsHookChannel[] = [], terminate = w.terminate;
+    w.addEventListener('message', ev => {
+        if (ev.data?.fsHookChannel) channels.push(new FsHookChannel(ev.data.fsHookChannel));
+    });
+    w.terminate = function () {
+        terminate.call(this);
+        for (let c of channels.splice(0)) c.close();
+    };
+}
+
+/**
+ * Runs at most `limit` tasks at a time; the rest wait their turn, in the
+ * order they came. A task that ends hands its slot straight to the first
+ * one waiting, so that a newcomer cannot take it in between.
+ */
+class Limiter {
+    active = 0
+    waiting: (() => void)[] = []
+
+    constructor(public limit: number) { }
+
+    async run<T>(task: () => Promise<T>) {
+        if (this.active < this.limit && this.waiting.length === 0) this.active++;
+        else await new Promise<void>(resolve => this.waiting.push(resolve));  /* the slot comes with it */
+        try { return await task(); }
+        finally {
+            let next = this.waiting.shift();
+            if (next) next();
+            else this.active--;
+        }
+    }
+}
+
+const DEFAULT_SPAWN_CONCURRENCY = 4;
+
+/** Read access to absolute paths through a set of mounts. */
+function mountedVolume(mounts: {[dir: string]: wasmer.Directory}) {
+    const locate = (path: string): [wasmer.Directory, string] => {
+        let dir = Object.keys(mounts)
+            .filter(d => d === '/' || path === d || path.startsWith(`${d}/`))
+            .sort((a, b) => b.length - a.length)[0];
+        if (dir === undefined) throw new Error(`not mounted: ${path}`);
+        return [mounts[dir], dir === '/' ? path : path.slice(dir.length) || '/'];
+    };
+    return {
+        async readdir(path: string) {
+            let [d, rel] = locate(path);
+            return (await d.readDir(rel)).map(e => e.name);
+        },
+        readFile(path: string) {
+            let [d, rel] = locate(path);
+            return d.readFile(rel);
+        }
+    };
+}
+
+
+/** this worker's line to the main thread, see `FsHookMaster` */
+let fsHookChannel: FsHookChannel;
 
 globalThis.fs_hook = {
     initiated(fs) {
         this.fs = fs;
     },
-    dispatch: (op) => {
-        console.warn('== fs_hook ==', op);
-        let out = new SharedArrayBuffer(8, {maxByteLength: 8e6});
-        postMessage({op, out});
-        Atomics.wait(new Int32Array(out), 0, 0);
+    dispatch: (op: number) => {
+        let t0 = Tracer.local.begin();
+        if (!fsHookChannel) {
+            fsHookChannel = FsHookChannel.create();
+            postMessage({fsHookChannel: fsHookChannel.to()});
+        }
+        let status = fsHookChannel.call(op);
+        Tracer.local.end(TraceEvent.FS_HOOK_WAIT, t0, op);
+        return status;
     },
     async intercept(m) {
         postMessage(m); // forward to parent until intercepted by main thread
@@ -107,5 +317,7 @@ globalThis.fs_hook = {
 }
 
 
+Tracer.local.listen();
+
 globalThis.WasikThreadPoolWorker = WasikThreadPoolWorker
 export { WasikThreadPoolWorker }
\ No newline at end of file
@@ -7,17 +7,27 @@ globalThis.onerror = console.error;
 globalThis.lastWasmError = undefined;
 
 let pendingMessages = [];
+let sdk;       // import started early by a `prewarm` message (see `WorkerPool`)
+let prewarmed;  // `init` too, if the message came with the memory
 let worker = {
   // Buffering up all messages until worker is initialized.
   handleMessage(msg) { pendingMessages.push(msg); }
 };
 
 globalThis.onmessage = async ev => {
+  if (ev.data.type == "prewarm") {
+    const { sdkUrl, module, memory } = ev.data;
+    sdk ??= import(/* webpackIgnore: true*/ sdkUrl);
+    if (memory) prewarmed ??= sdk.then(m => m.init({ module, memory }));
+    return;
+  }
   if (ev.data.type == "init") {
-    const { module, id, sdkUrl, workerUrl, memory } = ev.data;
+    const { module, id, sdkUrl, workerUrl, memory, pool, concurrency, signals, modules } = ev.data;
     //await import('./worker.js');
-    worker = new WasikThreadPoolWorker(await import(/* webpackIgnore: true*/ sdkUrl));
-    await worker.init(id, { module, sdkUrl, workerUrl, memory });
+    worker = new WasikThreadPoolWorker(await (sdk ?? import(/* webpackIgnore: true*/ sdkUrl)));
+    await prewarmed;
+    await worker.init(id, { module, sdkUrl, workerUrl, memory },
+                      { pool, concurrency, signals, modules, prewarmed: !!prewarmed });
     // handle any buffered messages
     worker.consume(pendingMessages);
   }